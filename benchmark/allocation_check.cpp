@@ -0,0 +1,229 @@
+/**
+ * @brief Fails if the warmed-up Shaper or TextArena paths perform heap allocations.
+ *
+ * Usage:
+ *
+ *   blend2d_shaping_allocation_check [FONT_FILE]
+ *
+ * HarfBuzz and Blend2D allocate through malloc, so besides operator new the
+ * C allocation functions are interposed as well. Needs glibc.
+ */
+
+#include <malloc.h>
+
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <new>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "benchmark_common.h"
+#include "blend2d_shaping.h"
+
+//
+// Allocation Counting
+//
+
+extern "C" {
+auto __libc_malloc(std::size_t size) -> void *;
+auto __libc_calloc(std::size_t count, std::size_t size) -> void *;
+auto __libc_realloc(void *pointer, std::size_t size) -> void *;
+auto __libc_memalign(std::size_t alignment, std::size_t size) -> void *;
+auto __libc_free(void *pointer) -> void;
+}
+
+namespace {
+
+std::atomic<bool> counting {false};
+std::atomic<uint64_t> allocation_count {0};
+
+auto count_allocation() -> void {
+    if (counting.load(std::memory_order_relaxed)) {
+        allocation_count.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+}  // namespace
+
+extern "C" {
+
+auto malloc(std::size_t size) -> void * {
+    count_allocation();
+    return __libc_malloc(size);
+}
+
+auto calloc(std::size_t count, std::size_t size) -> void * {
+    count_allocation();
+    return __libc_calloc(count, size);
+}
+
+auto realloc(void *pointer, std::size_t size) -> void * {
+    count_allocation();
+    return __libc_realloc(pointer, size);
+}
+
+auto aligned_alloc(std::size_t alignment, std::size_t size) -> void * {
+    count_allocation();
+    return __libc_memalign(alignment, size);
+}
+
+auto memalign(std::size_t alignment, std::size_t size) -> void * {
+    count_allocation();
+    return __libc_memalign(alignment, size);
+}
+
+auto posix_memalign(void **result, std::size_t alignment, std::size_t size) -> int {
+    count_allocation();
+    auto *pointer = __libc_memalign(alignment, size);
+    if (pointer == nullptr) {
+        return ENOMEM;
+    }
+    *result = pointer;
+    return 0;
+}
+
+auto free(void *pointer) -> void {
+    __libc_free(pointer);
+}
+
+}  // extern "C"
+
+// libstdc++ forwards all other forms to these
+auto operator new(std::size_t size) -> void * {
+    if (auto *pointer = malloc(size == 0 ? 1 : size)) {
+        return pointer;
+    }
+    throw std::bad_alloc {};
+}
+
+auto operator new(std::size_t size, std::align_val_t alignment) -> void * {
+    const auto align = static_cast<std::size_t>(alignment);
+    if (auto *pointer = memalign(align, size == 0 ? 1 : size)) {
+        return pointer;
+    }
+    throw std::bad_alloc {};
+}
+
+auto operator delete(void *pointer) noexcept -> void {
+    free(pointer);
+}
+
+auto operator delete(void *pointer, std::size_t /*size*/) noexcept -> void {
+    free(pointer);
+}
+
+auto operator delete(void *pointer, std::align_val_t /*alignment*/) noexcept -> void {
+    free(pointer);
+}
+
+auto operator delete(void *pointer, std::size_t /*size*/,
+                     std::align_val_t /*alignment*/) noexcept -> void {
+    free(pointer);
+}
+
+//
+// Check
+//
+
+namespace {
+
+using namespace blend2d_shaping;
+
+constexpr auto warmup_rounds = 4;
+constexpr auto measured_rounds = 1000;
+
+[[nodiscard]] auto create_texts() -> std::vector<std::string> {
+    auto texts = std::vector<std::string> {};
+
+    for (const auto &sample : benchmark_common::script_samples) {
+        texts.emplace_back(sample.text);
+        texts.emplace_back(sample.text.substr(0, sample.text.size() / 2));
+    }
+    texts.emplace_back("12.34 ms");
+    texts.emplace_back("99%");
+    texts.emplace_back();
+
+    return texts;
+}
+
+// returns the number of allocations of the rounds after warm-up
+template <typename Round>
+[[nodiscard]] auto count_steady_state_allocations(Round round_func) -> uint64_t {
+    for (int round = 0; round < warmup_rounds; ++round) {
+        round_func();
+    }
+
+    allocation_count.store(0);
+    counting.store(true);
+
+    for (int round = 0; round < measured_rounds; ++round) {
+        round_func();
+    }
+
+    counting.store(false);
+    return allocation_count.load();
+}
+
+[[nodiscard]] auto check_shaper(const Font &font, const std::vector<std::string> &texts)
+    -> uint64_t {
+    auto shaper = Shaper {font};
+    auto output = ShapedTextBuffer {};
+
+    return count_steady_state_allocations([&] {
+        for (const auto &text : texts) {
+            shaper.shape(text, output);
+        }
+    });
+}
+
+// every round is one frame of transient texts
+[[nodiscard]] auto check_text_arena(const Font &font,
+                                    const std::vector<std::string> &texts) -> uint64_t {
+    auto arena = TextArena {};
+
+    return count_steady_state_allocations([&] {
+        for (const auto &text : texts) {
+            static_cast<void>(arena.shape(text, font));
+        }
+        arena.reset();
+    });
+}
+
+auto report(std::string_view name, uint64_t allocations) -> bool {
+    if (allocations != 0) {
+        std::cerr << "FAILED: " << name << " allocated " << allocations
+                  << " times in steady state\n";
+        return false;
+    }
+    std::cout << "OK: " << name << " performed no allocations in steady state\n";
+    return true;
+}
+
+}  // namespace
+
+auto main(int argc, char *argv[]) -> int {
+    const auto *font_file = argc > 1 ? argv[1] : BLEND2D_SHAPING_FONT_FILE;
+
+    try {
+        const auto face = create_face_from_file(font_file);
+        const auto font = create_font(face, 16.0f);
+        const auto texts = create_texts();
+
+        const auto shaper_ok = report("Shaper", check_shaper(font, texts));
+        const auto arena_ok = report("TextArena", check_text_arena(font, texts));
+
+        if (!shaper_ok || !arena_ok) {
+            return 1;
+        }
+    } catch (const std::exception &exc) {
+        std::cerr << "error: " << exc.what() << '\n';
+        return 1;
+    }
+
+    return 0;
+}
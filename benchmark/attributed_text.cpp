@@ -0,0 +1,67 @@
+#include <benchmark/benchmark.h>
+#include <blend2d.h>
+
+#include <string>
+#include <vector>
+
+#include "benchmark_common.h"
+#include "blend2d_shaping.h"
+
+namespace {
+
+using namespace blend2d_shaping;
+using namespace blend2d_shaping::benchmark_common;
+
+// alternates two sizes every word
+[[nodiscard]] auto create_runs(std::string_view text) -> std::vector<AttributedRun> {
+    static const auto large_font = create_font(get_font_face(), 24.0f);
+
+    auto result = std::vector<AttributedRun> {};
+    auto begin = std::size_t {0};
+
+    while (begin < text.size()) {
+        const auto space = text.find(' ', begin);
+        const auto end = space == std::string_view::npos ? text.size() : space + 1;
+
+        result.push_back(AttributedRun {
+            .byte_begin = begin,
+            .byte_end = end,
+            .font = result.size() % 2 == 0 ? get_font() : large_font,
+        });
+        begin = end;
+    }
+    return result;
+}
+
+auto BM_AttributedText(benchmark::State &state) -> void {
+    const auto text = create_text(latin_sample, state.range(0));
+    const auto runs = create_runs(text);
+
+    for (auto _ : state) {
+        auto shaped = AttributedText {text, runs};
+        benchmark::DoNotOptimize(shaped);
+    }
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+
+auto BM_AttributedTextPerRun(benchmark::State &state) -> void {
+    const auto text = create_text(latin_sample, state.range(0));
+    const auto runs = create_runs(text);
+    const auto options =
+        ShapingOptions {.backend_policy = ShapingBackendPolicy::harfbuzz};
+
+    for (auto _ : state) {
+        for (const auto &run : runs) {
+            const auto span = std::string_view {text}.substr(
+                run.byte_begin, run.byte_end - run.byte_begin);
+            auto shaped = HbShapedText {span, run.font, options};
+            benchmark::DoNotOptimize(shaped);
+        }
+    }
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+
+}  // namespace
+
+BENCHMARK(BM_AttributedText)->RangeMultiplier(4)->Range(16, 1 << 12);
+BENCHMARK(BM_AttributedTextPerRun)->RangeMultiplier(4)->Range(16, 1 << 12);
@@ -0,0 +1,62 @@
+#ifndef BLEND2D_SHAPING_BENCHMARK_COMMON_H
+#define BLEND2D_SHAPING_BENCHMARK_COMMON_H
+
+#include <array>
+#include <string>
+#include <string_view>
+
+#include "blend2d_shaping.h"
+
+namespace blend2d_shaping::benchmark_common {
+
+constexpr auto latin_sample =
+    std::string_view {"The quick brown fox jumps over the lazy dog. "};
+
+struct ScriptSample {
+    std::string_view name;
+    std::string_view text;
+};
+
+// synthetic corpora, scripts not covered by the font shape to .notdef glyphs
+constexpr auto script_samples = std::array {
+    ScriptSample {"latin", latin_sample},
+    ScriptSample {"greek", "Ξεσκεπάζω την ψυχοφθόρα βδελυγμία. "},
+    ScriptSample {"cyrillic", "Съешь же ещё этих мягких французских булок. "},
+    ScriptSample {"vietnamese", "Tiếng Việt có dấu thanh điệu chồng lên nhau. "},
+    ScriptSample {"arabic", "نص حكيم له سر قاطع وذو شأن عظيم. "},
+    ScriptSample {"devanagari", "ऋषियों को सताने वाले दुष्ट राक्षसों. "},
+};
+
+// bundled NotoSans-Regular.ttf, loaded once
+[[nodiscard]] inline auto get_font_face() -> const FontFace & {
+    static const auto face = create_face_from_file(BLEND2D_SHAPING_FONT_FILE);
+    return face;
+}
+
+[[nodiscard]] inline auto get_font() -> const Font & {
+    static const auto font = create_font(get_font_face(), 16.0f);
+    return font;
+}
+
+// repeats the sample up to the given byte length, cut at a code point boundary
+[[nodiscard]] inline auto create_text(std::string_view sample, std::size_t length)
+    -> std::string {
+    auto result = std::string {};
+    result.reserve(length + sample.size());
+
+    while (result.size() < length) {
+        result.append(sample);
+    }
+
+    // UTF-8 continuation bytes are 10xxxxxx
+    while (length > 0 && length < result.size() &&
+           (static_cast<unsigned char>(result[length]) & 0xC0) == 0x80) {
+        --length;
+    }
+    result.resize(length);
+    return result;
+}
+
+}  // namespace blend2d_shaping::benchmark_common
+
+#endif
@@ -0,0 +1,31 @@
+#include <benchmark/benchmark.h>
+#include <blend2d.h>
+
+#include "benchmark_common.h"
+#include "blend2d_shaping.h"
+
+namespace {
+
+using namespace blend2d_shaping;
+using namespace blend2d_shaping::benchmark_common;
+
+auto BM_CreateFaceFromFile(benchmark::State &state) -> void {
+    for (auto _ : state) {
+        auto face = create_face_from_file(BLEND2D_SHAPING_FONT_FILE);
+        benchmark::DoNotOptimize(face);
+    }
+}
+
+auto BM_CreateFont(benchmark::State &state) -> void {
+    const auto &face = get_font_face();
+
+    for (auto _ : state) {
+        auto font = create_font(face, 16.0f);
+        benchmark::DoNotOptimize(font);
+    }
+}
+
+}  // namespace
+
+BENCHMARK(BM_CreateFaceFromFile)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_CreateFont);
@@ -0,0 +1,50 @@
+#include <benchmark/benchmark.h>
+#include <blend2d.h>
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <string_view>
+
+#include "benchmark_common.h"
+#include "blend2d_shaping.h"
+
+namespace {
+
+using namespace blend2d_shaping;
+using namespace blend2d_shaping::benchmark_common;
+
+constexpr auto suffixes = std::array {std::string_view {" ms"}, std::string_view {"%"}};
+
+auto BM_NumericShape(benchmark::State &state) -> void {
+    const auto shaper = NumericTextShaper {get_font(), suffixes};
+    auto value = 0.0;
+
+    for (auto _ : state) {
+        auto shaped = shaper.format(value, 2, " ms");
+        benchmark::DoNotOptimize(shaped);
+        value += 0.01;
+    }
+}
+
+auto BM_NumericReshape(benchmark::State &state) -> void {
+    const auto shaper = NumericTextShaper {get_font(), suffixes};
+    auto value = 0.0;
+
+    for (auto _ : state) {
+        auto buffer = std::array<char, 64> {};
+        const auto result = std::to_chars(buffer.data(), buffer.data() + 32, value,
+                                          std::chars_format::fixed, 2);
+        const auto end = std::ranges::copy(std::string_view {" ms"}, result.ptr).out;
+        const auto text = std::string_view {buffer.data(), end};
+
+        auto shaped = HbShapedText {text, get_font(), shaper.options()};
+        benchmark::DoNotOptimize(shaped);
+        value += 0.01;
+    }
+}
+
+}  // namespace
+
+BENCHMARK(BM_NumericShape);
+BENCHMARK(BM_NumericReshape);
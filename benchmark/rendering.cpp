@@ -0,0 +1,34 @@
+#include <benchmark/benchmark.h>
+#include <blend2d.h>
+
+#include "benchmark_common.h"
+#include "blend2d_shaping.h"
+
+namespace {
+
+using namespace blend2d_shaping;
+using namespace blend2d_shaping::benchmark_common;
+
+auto BM_FillGlyphRun(benchmark::State &state) -> void {
+    const auto text = create_text(latin_sample, static_cast<std::size_t>(state.range(0)));
+    const auto &font = get_font();
+    const auto shaped = HbShapedText {text, font};
+
+    // wide enough for the longest text, so all glyphs are rasterized
+    auto image = BLImage {8 * 4096, 32, BL_FORMAT_PRGB32};
+    auto context = BLContext {image};
+
+    for (auto _ : state) {
+        context.fillGlyphRun(BLPoint {0, 24}, font.bl_font, shaped.glyph_run(),
+                             BLRgba32(0xFF000000));
+        context.flush(BL_CONTEXT_FLUSH_SYNC);
+    }
+    context.end();
+
+    state.SetItemsProcessed(state.iterations() *
+                            static_cast<int64_t>(shaped.glyph_run().size));
+}
+
+}  // namespace
+
+BENCHMARK(BM_FillGlyphRun)->RangeMultiplier(4)->Range(16, 1 << 12);
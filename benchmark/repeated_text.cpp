@@ -0,0 +1,36 @@
+#include <benchmark/benchmark.h>
+#include <blend2d.h>
+
+#include <string>
+
+#include "benchmark_common.h"
+#include "blend2d_shaping.h"
+
+namespace {
+
+using namespace blend2d_shaping;
+using namespace blend2d_shaping::benchmark_common;
+
+auto BM_RepeatedShape(benchmark::State &state) -> void {
+    const auto text = std::string(state.range(0), '.');
+
+    for (auto _ : state) {
+        auto shaped = HbShapedText {text, get_font()};
+        benchmark::DoNotOptimize(shaped);
+    }
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+
+auto BM_FillToWidth(benchmark::State &state) -> void {
+    const auto width = static_cast<double>(state.range(0));
+
+    for (auto _ : state) {
+        auto shaped = fill_to_width(". ", get_font(), width);
+        benchmark::DoNotOptimize(shaped);
+    }
+}
+
+}  // namespace
+
+BENCHMARK(BM_RepeatedShape)->RangeMultiplier(4)->Range(16, 1 << 14);
+BENCHMARK(BM_FillToWidth)->RangeMultiplier(4)->Range(64, 1 << 14);
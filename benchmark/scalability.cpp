@@ -0,0 +1,311 @@
+/**
+ * @brief Multi-core scaling of shaping and rendering with a JSON report.
+ *
+ * Usage:
+ *
+ *   blend2d_shaping_scalability --font FILE [--corpus FILE] [--max-threads N]
+ *       [--items N] [--backend automatic|harfbuzz|blend2d]
+ *
+ * Each scenario runs with 1, 2, 4, ... up to the maximum thread count. Every
+ * thread processes the same number of items, so with perfect scaling the
+ * throughput grows linearly. Efficiency is the speedup divided by the thread
+ * count, scenarios that fall below 75% are reported as contended.
+ *
+ * Texts are shaped by HarfBuzz by default, as the automatic policy shapes
+ * simple Latin text with Blend2D and would not exercise the HarfBuzz objects.
+ */
+
+#include <blend2d.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <latch>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "blend2d_shaping.h"
+#include "tool_common.h"
+
+namespace {
+
+using namespace blend2d_shaping;
+using namespace blend2d_shaping::tool_common;
+
+using Clock = std::chrono::steady_clock;
+
+constexpr auto contended_efficiency = 0.75;
+
+struct Arguments {
+    std::string font_file {};
+    std::string corpus_file {};
+    std::size_t max_threads {std::max(std::thread::hardware_concurrency(), 1u)};
+    // processed by each thread
+    std::size_t items {20'000};
+    ShapingOptions options {.backend_policy = ShapingBackendPolicy::harfbuzz};
+};
+
+[[nodiscard]] auto parse_arguments(std::span<char *const> args) -> Arguments {
+    auto result = Arguments {};
+
+    for (std::size_t i = 1; i < args.size(); ++i) {
+        const auto name = std::string_view {args[i]};
+        if (i + 1 >= args.size()) {
+            throw std::runtime_error("Missing value for " + std::string {name});
+        }
+        const auto value = std::string_view {args[++i]};
+
+        if (name == "--font") {
+            result.font_file = value;
+        } else if (name == "--corpus") {
+            result.corpus_file = value;
+        } else if (name == "--max-threads") {
+            result.max_threads = std::max(parse_count(value), std::size_t {1});
+        } else if (name == "--items") {
+            result.items = std::max(parse_count(value), std::size_t {1});
+        } else if (name == "--backend") {
+            result.options.backend_policy = parse_name(backend_names, value);
+        } else {
+            throw std::runtime_error("Unknown argument " + std::string {name});
+        }
+    }
+
+    if (result.font_file.empty()) {
+        throw std::runtime_error("Argument --font is required");
+    }
+    return result;
+}
+
+// lines of varying length cut from a pangram
+[[nodiscard]] auto create_synthetic_corpus() -> std::vector<std::string> {
+    constexpr auto sample =
+        std::string_view {"The quick brown fox jumps over the lazy dog. "};
+
+    auto result = std::vector<std::string> {};
+    for (std::size_t i = 0; i < 256; ++i) {
+        const auto length = 8 + (i * 37) % 120;
+        auto line = std::string {};
+        while (line.size() < length + i % sample.size()) {
+            line.append(sample);
+        }
+        result.push_back(line.substr(i % sample.size(), length));
+    }
+    return result;
+}
+
+//
+// Scenarios
+//
+
+enum class FontSharing : uint8_t {
+    shared_font,
+    // per-thread fonts still share the face and its table accelerators
+    per_thread_font,
+    // loads the face per thread, so threads share no HarfBuzz objects
+    per_thread_face,
+};
+
+struct Scenario {
+    std::string_view name;
+    FontSharing sharing {FontSharing::shared_font};
+    bool cached {false};
+    bool render {false};
+};
+
+constexpr auto scenarios = std::array {
+    Scenario {.name = "shared_font"},
+    Scenario {.name = "per_thread_font", .sharing = FontSharing::per_thread_font},
+    Scenario {.name = "per_thread_face", .sharing = FontSharing::per_thread_face},
+    Scenario {.name = "shared_font_cached", .cached = true},
+    Scenario {.name = "shared_font_render", .render = true},
+};
+
+[[nodiscard]] auto create_worker_font(const Scenario &scenario,
+                                      const Arguments &arguments, const FontFace &face,
+                                      const Font &font) -> Font {
+    switch (scenario.sharing) {
+        case FontSharing::shared_font:
+            return font;
+        case FontSharing::per_thread_font:
+            return create_font(face, font.bl_font.size());
+        case FontSharing::per_thread_face:
+            return create_font(create_face_from_file(arguments.font_file.c_str()),
+                               font.bl_font.size());
+    }
+    return font;
+}
+
+class Worker {
+   public:
+    explicit Worker(const Scenario &scenario, const Arguments &arguments,
+                    const FontFace &face, const Font &font)
+        : scenario_ {scenario},
+          options_ {arguments.options},
+          font_ {create_worker_font(scenario, arguments, face, font)} {
+        if (scenario.cached) {
+            cache_.emplace(font_, 4096, options_);
+        }
+        if (scenario.render) {
+            image_ = BLImage {4096, 64, BL_FORMAT_PRGB32};
+            context_.begin(image_);
+        }
+    }
+
+    auto process(std::string_view text_utf8) -> void {
+        if (cache_) {
+            draw(cache_->get(text_utf8));
+        } else {
+            draw(HbShapedText {text_utf8, font_, options_});
+        }
+    }
+
+    auto finish() -> void {
+        if (scenario_.render) {
+            context_.end();
+        }
+    }
+
+   private:
+    auto draw(const HbShapedText &shaped) -> void {
+        if (scenario_.render) {
+            context_.fillGlyphRun(BLPoint {0, 48}, font_.bl_font, shaped.glyph_run(),
+                                  BLRgba32(0xFF000000));
+        }
+    }
+
+    const Scenario &scenario_;
+    const ShapingOptions &options_;
+    const Font font_;
+
+    std::optional<ShapedTextCache> cache_ {};
+    BLImage image_ {};
+    BLContext context_ {};
+};
+
+// items per second of all threads
+[[nodiscard]] auto measure(const Scenario &scenario, const Arguments &arguments,
+                           const FontFace &face, const Font &font,
+                           const std::vector<std::string> &corpus,
+                           std::size_t thread_count) -> double {
+    const auto items = arguments.items;
+    auto ready = std::latch {static_cast<std::ptrdiff_t>(thread_count + 1)};
+    auto start = std::latch {1};
+    auto done = std::latch {static_cast<std::ptrdiff_t>(thread_count)};
+
+    const auto work = [&](std::size_t index) {
+        // setup, like font creation, is not measured
+        auto worker = Worker {scenario, arguments, face, font};
+        ready.count_down();
+        start.wait();
+
+        for (std::size_t i = 0; i < items; ++i) {
+            worker.process(corpus[(index * 31 + i) % corpus.size()]);
+        }
+        done.count_down();
+        worker.finish();
+    };
+
+    auto threads = std::vector<std::jthread> {};
+    threads.reserve(thread_count);
+    for (std::size_t i = 0; i < thread_count; ++i) {
+        threads.emplace_back(work, i);
+    }
+
+    ready.arrive_and_wait();
+    const auto begin = Clock::now();
+    start.count_down();
+    done.wait();
+    const auto seconds = std::chrono::duration<double>(Clock::now() - begin).count();
+
+    threads.clear();
+    return static_cast<double>(thread_count * items) / seconds;
+}
+
+[[nodiscard]] auto thread_counts(std::size_t max_threads) -> std::vector<std::size_t> {
+    auto result = std::vector<std::size_t> {};
+    for (std::size_t count = 1; count < max_threads; count *= 2) {
+        result.push_back(count);
+    }
+    result.push_back(max_threads);
+    return result;
+}
+
+auto run(const Arguments &arguments) -> void {
+    const auto face = create_face_from_file(arguments.font_file.c_str());
+    const auto font = create_font(face, 16.0f);
+    const auto corpus = arguments.corpus_file.empty()
+                            ? create_synthetic_corpus()
+                            : read_corpus(arguments.corpus_file);
+    if (corpus.empty()) {
+        throw std::runtime_error("Corpus has no items");
+    }
+
+    const auto counts = thread_counts(arguments.max_threads);
+
+    std::cout << "{\n"
+              << "  \"font\": " << json_string(arguments.font_file) << ",\n"
+              << "  \"items_per_thread\": " << arguments.items << ",\n"
+              << "  \"backend\": \""
+              << format_name(backend_names, arguments.options.backend_policy) << "\",\n"
+              << "  \"scenarios\": [\n";
+
+    for (std::size_t s = 0; s < scenarios.size(); ++s) {
+        const auto &scenario = scenarios[s];
+        auto baseline = 0.0;
+        auto contended_from = std::optional<std::size_t> {};
+
+        std::cout << "    {\"name\": \"" << scenario.name << "\", \"points\": [\n";
+
+        for (std::size_t c = 0; c < counts.size(); ++c) {
+            const auto threads = counts[c];
+            const auto throughput =
+                measure(scenario, arguments, face, font, corpus, threads);
+            if (threads == 1) {
+                baseline = throughput;
+            }
+
+            const auto speedup = throughput / baseline;
+            const auto efficiency = speedup / static_cast<double>(threads);
+            if (!contended_from && efficiency < contended_efficiency) {
+                contended_from = threads;
+            }
+
+            std::cout << "      {\"threads\": " << threads
+                      << ", \"items_per_second\": " << throughput
+                      << ", \"speedup\": " << speedup
+                      << ", \"efficiency\": " << efficiency << "}"
+                      << (c + 1 < counts.size() ? ",\n" : "\n");
+        }
+
+        std::cout << "    ], \"contended_from_threads\": ";
+        if (contended_from) {
+            std::cout << *contended_from;
+        } else {
+            std::cout << "null";
+        }
+        std::cout << "}" << (s + 1 < scenarios.size() ? ",\n" : "\n");
+    }
+
+    std::cout << "  ]\n"
+              << "}\n";
+}
+
+}  // namespace
+
+auto main(int argc, char *argv[]) -> int {
+    try {
+        run(parse_arguments(std::span {argv, static_cast<std::size_t>(argc)}));
+    } catch (const std::runtime_error &exc) {
+        std::cerr << "Exception: " << exc.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
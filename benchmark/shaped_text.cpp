@@ -0,0 +1,106 @@
+#include <benchmark/benchmark.h>
+#include <blend2d.h>
+#include <hb.h>
+
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "benchmark_common.h"
+#include "blend2d_shaping.h"
+
+namespace {
+
+using namespace blend2d_shaping;
+using namespace blend2d_shaping::benchmark_common;
+
+auto BM_ShapeScript(benchmark::State &state) -> void {
+    const auto &sample = script_samples.at(static_cast<std::size_t>(state.range(0)));
+    const auto text = create_text(sample.text, static_cast<std::size_t>(state.range(1)));
+    const auto &font = get_font();
+
+    for (auto _ : state) {
+        auto shaped = HbShapedText {text, font.hb_font, font.bl_font.size()};
+        benchmark::DoNotOptimize(shaped);
+    }
+    state.SetLabel(std::string {sample.name});
+    state.SetBytesProcessed(state.iterations() * state.range(1));
+}
+
+auto script_arguments(benchmark::internal::Benchmark *benchmark) -> void {
+    for (auto script = std::size_t {0}; script < script_samples.size(); ++script) {
+        for (auto length = 16; length <= (1 << 12); length *= 4) {
+            benchmark->Args({static_cast<int64_t>(script), length});
+        }
+    }
+}
+
+// hb_shape alone, the difference to BM_ShapeScript is conversion and bounds
+auto BM_HarfBuzzShapeOnly(benchmark::State &state) -> void {
+    const auto text = create_text(latin_sample, static_cast<std::size_t>(state.range(0)));
+    auto *hb_font = get_font().hb_font.hb_font();
+
+    const auto buffer = std::unique_ptr<hb_buffer_t, decltype(&hb_buffer_destroy)> {
+        hb_buffer_create(), &hb_buffer_destroy};
+
+    for (auto _ : state) {
+        hb_buffer_clear_contents(buffer.get());
+        hb_buffer_add_utf8(buffer.get(), text.data(), static_cast<int>(text.size()), 0,
+                           static_cast<int>(text.size()));
+        hb_buffer_guess_segment_properties(buffer.get());
+        hb_shape(hb_font, buffer.get(), nullptr, 0);
+        benchmark::DoNotOptimize(hb_buffer_get_length(buffer.get()));
+    }
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+
+// HarfBuzz positions to Blend2D placements, as after every hb_shape
+auto BM_PlacementConversion(benchmark::State &state) -> void {
+    const auto text = create_text(latin_sample, static_cast<std::size_t>(state.range(0)));
+    auto *hb_font = get_font().hb_font.hb_font();
+
+    const auto buffer = std::unique_ptr<hb_buffer_t, decltype(&hb_buffer_destroy)> {
+        hb_buffer_create(), &hb_buffer_destroy};
+    hb_buffer_add_utf8(buffer.get(), text.data(), static_cast<int>(text.size()), 0,
+                       static_cast<int>(text.size()));
+    hb_buffer_guess_segment_properties(buffer.get());
+    hb_shape(hb_font, buffer.get(), nullptr, 0);
+
+    auto length = 0U;
+    const auto *positions = hb_buffer_get_glyph_positions(buffer.get(), &length);
+
+    for (auto _ : state) {
+        auto placements = std::vector<BLGlyphPlacement> {};
+        placements.reserve(length);
+        for (const auto &position : std::span {positions, length}) {
+            placements.push_back(BLGlyphPlacement {
+                .placement = BLPointI {position.x_offset, position.y_offset},
+                .advance = BLPointI {position.x_advance, position.y_advance},
+            });
+        }
+        benchmark::DoNotOptimize(placements.data());
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(length));
+}
+
+auto BM_BoundingBox(benchmark::State &state) -> void {
+    const auto text = create_text(latin_sample, static_cast<std::size_t>(state.range(0)));
+    const auto &font = get_font();
+    const auto shaped = HbShapedText {text, font};
+
+    for (auto _ : state) {
+        auto box =
+            calculate_bounding_box(shaped.glyph_run(), font.hb_font, font.bl_font.size());
+        benchmark::DoNotOptimize(box);
+    }
+    state.SetItemsProcessed(state.iterations() *
+                            static_cast<int64_t>(shaped.glyph_run().size));
+}
+
+}  // namespace
+
+BENCHMARK(BM_ShapeScript)->Apply(script_arguments);
+BENCHMARK(BM_HarfBuzzShapeOnly)->RangeMultiplier(4)->Range(16, 1 << 12);
+BENCHMARK(BM_PlacementConversion)->RangeMultiplier(4)->Range(16, 1 << 12);
+BENCHMARK(BM_BoundingBox)->RangeMultiplier(4)->Range(16, 1 << 12);
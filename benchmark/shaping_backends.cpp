@@ -0,0 +1,59 @@
+#include <benchmark/benchmark.h>
+#include <blend2d.h>
+
+#include "benchmark_common.h"
+#include "blend2d_shaping.h"
+
+namespace {
+
+using namespace blend2d_shaping;
+using namespace blend2d_shaping::benchmark_common;
+
+auto shape_with_options(benchmark::State &state, const ShapingOptions &options) -> void {
+    const auto &font = get_font();
+    const auto text = create_text(latin_sample, static_cast<std::size_t>(state.range(0)));
+
+    for (auto _ : state) {
+        auto shaped = HbShapedText {text, font, options};
+        benchmark::DoNotOptimize(shaped);
+    }
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+
+auto BM_ShapeHarfBuzz(benchmark::State &state) -> void {
+    shape_with_options(state, {.backend_policy = ShapingBackendPolicy::harfbuzz});
+}
+
+auto BM_ShapeBlend2D(benchmark::State &state) -> void {
+    shape_with_options(state, {.backend_policy = ShapingBackendPolicy::blend2d});
+}
+
+auto BM_ShapeAutomatic(benchmark::State &state) -> void {
+    shape_with_options(state, {.backend_policy = ShapingBackendPolicy::automatic});
+}
+
+auto BM_ShapeKerningOnly(benchmark::State &state) -> void {
+    shape_with_options(state, {.quality = ShapingQuality::kerning_only});
+}
+
+auto BM_ShapeNominal(benchmark::State &state) -> void {
+    shape_with_options(state, {.quality = ShapingQuality::nominal});
+}
+
+auto BM_SelectBackend(benchmark::State &state) -> void {
+    const auto text = create_text(latin_sample, static_cast<std::size_t>(state.range(0)));
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(select_shaping_backend(text));
+    }
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+
+}  // namespace
+
+BENCHMARK(BM_ShapeHarfBuzz)->RangeMultiplier(4)->Range(1, 1 << 12);
+BENCHMARK(BM_ShapeBlend2D)->RangeMultiplier(4)->Range(1, 1 << 12);
+BENCHMARK(BM_ShapeAutomatic)->RangeMultiplier(4)->Range(1, 1 << 12);
+BENCHMARK(BM_ShapeKerningOnly)->RangeMultiplier(4)->Range(1, 1 << 12);
+BENCHMARK(BM_ShapeNominal)->RangeMultiplier(4)->Range(1, 1 << 12);
+BENCHMARK(BM_SelectBackend)->RangeMultiplier(4)->Range(1, 1 << 12);
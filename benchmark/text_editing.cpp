@@ -0,0 +1,98 @@
+#include <benchmark/benchmark.h>
+#include <blend2d.h>
+
+#include <string>
+#include <string_view>
+
+#include "benchmark_common.h"
+#include "blend2d_shaping.h"
+
+namespace {
+
+using namespace blend2d_shaping;
+using namespace blend2d_shaping::benchmark_common;
+
+constexpr auto appended_word = std::string_view {"message "};
+
+// the second argument selects HarfBuzz or the automatic policy, which shapes
+// the words with Blend2D
+[[nodiscard]] auto append_options(const benchmark::State &state) -> ShapingOptions {
+    return ShapingOptions {.backend_policy = state.range(1) == 0
+                                                 ? ShapingBackendPolicy::harfbuzz
+                                                 : ShapingBackendPolicy::automatic};
+}
+
+auto BM_AppendShaped(benchmark::State &state) -> void {
+    const auto &font = get_font();
+    const auto options = append_options(state);
+
+    for (auto _ : state) {
+        auto shaped = EditableShapedText {"", font, options};
+        for (auto i = 0; i < state.range(0); ++i) {
+            shaped.append(appended_word);
+        }
+        benchmark::DoNotOptimize(shaped);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+auto BM_AppendReshape(benchmark::State &state) -> void {
+    const auto &font = get_font();
+    const auto options = append_options(state);
+
+    for (auto _ : state) {
+        auto text = std::string {};
+        auto shaped = HbShapedText {};
+        for (auto i = 0; i < state.range(0); ++i) {
+            text.append(appended_word);
+            shaped = HbShapedText {text, font, options};
+        }
+        benchmark::DoNotOptimize(shaped);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+auto BM_SliceShaped(benchmark::State &state) -> void {
+    const auto text = create_text(latin_sample, 1024);
+    const auto shaped = EditableShapedText {text, get_font()};
+    auto begin = std::size_t {0};
+
+    for (auto _ : state) {
+        auto slice = shaped.slice(begin, begin + 64);
+        benchmark::DoNotOptimize(slice);
+        begin = (begin + 1) % (text.size() - 64);
+    }
+}
+
+auto BM_SliceReshape(benchmark::State &state) -> void {
+    const auto text = create_text(latin_sample, 1024);
+    auto begin = std::size_t {0};
+
+    for (auto _ : state) {
+        auto slice = HbShapedText {std::string_view {text}.substr(begin, 64), get_font()};
+        benchmark::DoNotOptimize(slice);
+        begin = (begin + 1) % (text.size() - 64);
+    }
+}
+
+auto BM_DiffShaped(benchmark::State &state) -> void {
+    const auto text = create_text(latin_sample, 1024);
+    auto changed = text;
+    changed[changed.size() / 2] = '#';
+
+    const auto previous = HbShapedText {text, get_font()};
+    const auto next = HbShapedText {changed, get_font()};
+
+    for (auto _ : state) {
+        auto result = diff(previous, next, get_font().hb_font);
+        benchmark::DoNotOptimize(result);
+    }
+}
+
+}  // namespace
+
+BENCHMARK(BM_AppendShaped)->ArgsProduct({benchmark::CreateRange(1, 256, 4), {0, 1}});
+BENCHMARK(BM_AppendReshape)->ArgsProduct({benchmark::CreateRange(1, 256, 4), {0, 1}});
+BENCHMARK(BM_SliceShaped);
+BENCHMARK(BM_SliceReshape);
+BENCHMARK(BM_DiffShaped);
@@ -0,0 +1,88 @@
+#include <benchmark/benchmark.h>
+#include <blend2d.h>
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "benchmark_common.h"
+#include "blend2d_shaping.h"
+
+namespace {
+
+using namespace blend2d_shaping;
+using namespace blend2d_shaping::benchmark_common;
+
+auto BM_TemplateInstantiate(benchmark::State &state) -> void {
+    const auto label = ShapedTextTemplate {"CPU {0}% - {1} threads", get_font()};
+    auto counter = 0;
+
+    for (auto _ : state) {
+        const auto usage = std::to_string(counter % 100);
+        const auto threads = std::to_string(counter % 64);
+        const auto fields =
+            std::array {std::string_view {usage}, std::string_view {threads}};
+
+        auto shaped = label.instantiate(fields);
+        benchmark::DoNotOptimize(shaped);
+        ++counter;
+    }
+}
+
+auto BM_TemplateReshape(benchmark::State &state) -> void {
+    auto counter = 0;
+
+    for (auto _ : state) {
+        const auto text = "CPU " + std::to_string(counter % 100) + "% - " +
+                          std::to_string(counter % 64) + " threads";
+
+        auto shaped = HbShapedText {text, get_font()};
+        benchmark::DoNotOptimize(shaped);
+        ++counter;
+    }
+}
+
+// static text with kerned pairs before the field, shaped by Blend2D
+[[nodiscard]] auto long_label_text(int64_t words) -> std::string {
+    auto result = std::string {};
+    for (auto i = int64_t {0}; i < words; ++i) {
+        result.append("Wave To ");
+    }
+    return result;
+}
+
+auto BM_TemplateInstantiateLongText(benchmark::State &state) -> void {
+    const auto label =
+        ShapedTextTemplate {long_label_text(state.range(0)) + "{0} ms", get_font()};
+    auto counter = 0;
+
+    for (auto _ : state) {
+        const auto value = std::to_string(counter % 1000);
+        const auto fields = std::array {std::string_view {value}};
+
+        auto shaped = label.instantiate(fields);
+        benchmark::DoNotOptimize(shaped);
+        ++counter;
+    }
+}
+
+auto BM_TemplateReshapeLongText(benchmark::State &state) -> void {
+    const auto prefix = long_label_text(state.range(0));
+    auto counter = 0;
+
+    for (auto _ : state) {
+        const auto text = prefix + std::to_string(counter % 1000) + " ms";
+
+        auto shaped = HbShapedText {text, get_font()};
+        benchmark::DoNotOptimize(shaped);
+        ++counter;
+    }
+}
+
+}  // namespace
+
+BENCHMARK(BM_TemplateInstantiate);
+BENCHMARK(BM_TemplateReshape);
+BENCHMARK(BM_TemplateInstantiateLongText)->Arg(4)->Arg(64);
+BENCHMARK(BM_TemplateReshapeLongText)->Arg(4)->Arg(64);
@@ -0,0 +1,399 @@
+/**
+ * @brief End-to-end shaping throughput of a text corpus with a JSON report.
+ *
+ * Usage:
+ *
+ *   blend2d_shaping_throughput --font FILE --corpus FILE [--threads N]
+ *       [--batch N] [--cache N] [--iterations N] [--size PX] [--render]
+ *       [--trace FILE]
+ *       [--backend automatic|harfbuzz|blend2d]
+ *       [--quality full|kerning_only|nominal|monospace]
+ *
+ * Every non-empty line of the corpus is one item. Threads take batches of
+ * items, optionally from a per-thread cache, shape and optionally render them.
+ */
+
+#include <blend2d.h>
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <latch>
+#include <memory>
+#include <new>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "blend2d_shaping.h"
+#include "tool_common.h"
+
+//
+// Allocation Counting
+//
+
+namespace {
+
+std::atomic<uint64_t> allocation_count {0};
+std::atomic<uint64_t> allocated_bytes {0};
+
+auto count_allocation(std::size_t size) -> void {
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+}
+
+}  // namespace
+
+// array and nothrow forms forward to these by default
+auto operator new(std::size_t size) -> void * {
+    count_allocation(size);
+    if (auto *pointer = std::malloc(size == 0 ? 1 : size)) {
+        return pointer;
+    }
+    throw std::bad_alloc {};
+}
+
+auto operator new(std::size_t size, std::align_val_t alignment) -> void * {
+    count_allocation(size);
+    const auto align = static_cast<std::size_t>(alignment);
+    const auto rounded = (std::max(size, std::size_t {1}) + align - 1) / align * align;
+    if (auto *pointer = std::aligned_alloc(align, rounded)) {
+        return pointer;
+    }
+    throw std::bad_alloc {};
+}
+
+auto operator delete(void *pointer) noexcept -> void {
+    std::free(pointer);
+}
+
+auto operator delete(void *pointer, std::size_t /*size*/) noexcept -> void {
+    std::free(pointer);
+}
+
+auto operator delete(void *pointer, std::align_val_t /*alignment*/) noexcept -> void {
+    std::free(pointer);
+}
+
+auto operator delete(void *pointer, std::size_t /*size*/,
+                     std::align_val_t /*alignment*/) noexcept -> void {
+    std::free(pointer);
+}
+
+namespace {
+
+using namespace blend2d_shaping;
+using namespace blend2d_shaping::tool_common;
+
+//
+// Arguments
+//
+
+struct Arguments {
+    std::string font_file {};
+    std::string corpus_file {};
+    std::size_t threads {1};
+    std::size_t batch_size {64};
+    // capacity of the per-thread cache, zero disables caching
+    std::size_t cache_capacity {0};
+    std::size_t iterations {1};
+    float font_size {16.0f};
+    bool render {false};
+    // Chrome trace-event JSON, if the library is built with tracing
+    std::string trace_file {};
+    ShapingOptions options {};
+};
+
+[[nodiscard]] auto parse_size(std::string_view value) -> float {
+    const auto *last = value.data() + value.size();
+    auto result = float {};
+    const auto [ptr, ec] = std::from_chars(value.data(), last, result);
+    if (ec != std::errc {} || ptr != last || !(result > 0)) {
+        throw std::runtime_error("Invalid size " + std::string {value});
+    }
+    return result;
+}
+
+[[nodiscard]] auto parse_arguments(std::span<char *const> args) -> Arguments {
+    auto result = Arguments {};
+
+    for (std::size_t i = 1; i < args.size(); ++i) {
+        const auto name = std::string_view {args[i]};
+
+        if (name == "--render") {
+            result.render = true;
+            continue;
+        }
+        if (i + 1 >= args.size()) {
+            throw std::runtime_error("Missing value for " + std::string {name});
+        }
+        const auto value = std::string_view {args[++i]};
+
+        if (name == "--font") {
+            result.font_file = value;
+        } else if (name == "--corpus") {
+            result.corpus_file = value;
+        } else if (name == "--trace") {
+            result.trace_file = value;
+        } else if (name == "--threads") {
+            result.threads = std::max(parse_count(value), std::size_t {1});
+        } else if (name == "--batch") {
+            result.batch_size = std::max(parse_count(value), std::size_t {1});
+        } else if (name == "--cache") {
+            result.cache_capacity = parse_count(value);
+        } else if (name == "--iterations") {
+            result.iterations = std::max(parse_count(value), std::size_t {1});
+        } else if (name == "--size") {
+            result.font_size = parse_size(value);
+        } else if (name == "--backend") {
+            result.options.backend_policy = parse_name(backend_names, value);
+        } else if (name == "--quality") {
+            result.options.quality = parse_name(quality_names, value);
+        } else {
+            throw std::runtime_error("Unknown argument " + std::string {name});
+        }
+    }
+
+    if (result.font_file.empty() || result.corpus_file.empty()) {
+        throw std::runtime_error("Arguments --font and --corpus are required");
+    }
+    return result;
+}
+
+//
+// Workers
+//
+
+using Clock = std::chrono::steady_clock;
+
+struct WorkerResult {
+    uint64_t glyphs {};
+    uint64_t cache_hits {};
+    uint64_t cache_misses {};
+    // per item in nanoseconds
+    std::vector<int64_t> latencies {};
+};
+
+class Worker {
+   public:
+    explicit Worker(const Arguments &arguments, const Font &font,
+                    std::size_t expected_items)
+        : arguments_ {arguments}, font_ {font} {
+        // keeps allocations of the harness out of the measurement
+        result_.latencies.reserve(expected_items);
+
+        if (arguments.cache_capacity > 0) {
+            cache_.emplace(font, arguments.cache_capacity, arguments.options);
+        }
+        if (arguments.render) {
+            image_ = BLImage {4096, 64, BL_FORMAT_PRGB32};
+            context_.begin(image_);
+        }
+    }
+
+    auto process(std::string_view text_utf8) -> void {
+        const auto start = Clock::now();
+
+        if (cache_) {
+            draw(cache_->get(text_utf8));
+        } else {
+            draw(HbShapedText {text_utf8, font_, arguments_.options});
+        }
+
+        const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            Clock::now() - start);
+        result_.latencies.push_back(elapsed.count());
+    }
+
+    [[nodiscard]] auto finish() -> WorkerResult {
+        if (arguments_.render) {
+            context_.end();
+        }
+        if (cache_) {
+            result_.cache_hits = cache_->hits();
+            result_.cache_misses = cache_->misses();
+        }
+        return std::move(result_);
+    }
+
+   private:
+    auto draw(const HbShapedText &shaped) -> void {
+        const auto glyph_run = shaped.glyph_run();
+        result_.glyphs += glyph_run.size;
+
+        if (arguments_.render) {
+            context_.fillGlyphRun(BLPoint {0, 48}, font_.bl_font, glyph_run,
+                                  BLRgba32(0xFF000000));
+        }
+    }
+
+    const Arguments &arguments_;
+    const Font &font_;
+
+    std::optional<ShapedTextCache> cache_ {};
+    BLImage image_ {};
+    BLContext context_ {};
+    WorkerResult result_ {};
+};
+
+struct RunResult {
+    std::vector<WorkerResult> workers {};
+    double seconds {};
+    // made while the workers shape, without the setup of the harness
+    uint64_t allocations {};
+    uint64_t allocated_bytes {};
+};
+
+[[nodiscard]] auto run_workers(const Arguments &arguments, const Font &font,
+                               const std::vector<std::string> &corpus) -> RunResult {
+    const auto item_count = corpus.size() * arguments.iterations;
+    auto next_item = std::atomic<std::size_t> {0};
+    auto result = RunResult {.workers = std::vector<WorkerResult>(arguments.threads)};
+
+    // workers set up their caches and contexts before the measurement starts
+    auto ready = std::latch {static_cast<std::ptrdiff_t>(arguments.threads)};
+    auto start = std::latch {1};
+
+    const auto work = [&](std::size_t index) {
+        auto worker = Worker {arguments, font,
+                              item_count / arguments.threads + arguments.batch_size};
+        ready.count_down();
+        start.wait();
+
+        while (true) {
+            const auto first = next_item.fetch_add(arguments.batch_size);
+            if (first >= item_count) {
+                break;
+            }
+            const auto last = std::min(first + arguments.batch_size, item_count);
+
+            const auto span = TraceSpan {"batch", "throughput"};
+            for (auto item = first; item < last; ++item) {
+                worker.process(corpus[item % corpus.size()]);
+            }
+        }
+        result.workers[index] = worker.finish();
+    };
+
+    auto threads = std::vector<std::jthread> {};
+    threads.reserve(arguments.threads);
+    for (std::size_t i = 0; i < arguments.threads; ++i) {
+        threads.emplace_back(work, i);
+    }
+    ready.wait();
+
+    const auto allocations_before = allocation_count.load();
+    const auto bytes_before = allocated_bytes.load();
+    const auto start_time = Clock::now();
+    start.count_down();
+
+    threads.clear();
+
+    result.seconds = std::chrono::duration<double>(Clock::now() - start_time).count();
+    result.allocations = allocation_count.load() - allocations_before;
+    result.allocated_bytes = allocated_bytes.load() - bytes_before;
+    return result;
+}
+
+//
+// Report
+//
+
+[[nodiscard]] auto percentile(std::span<const int64_t> sorted, double fraction)
+    -> int64_t {
+    if (sorted.empty()) {
+        return 0;
+    }
+    const auto index = static_cast<std::size_t>(fraction * (sorted.size() - 1) + 0.5);
+    return sorted[std::min(index, sorted.size() - 1)];
+}
+
+// maximum resident set size of the process in KiB, as reported by Linux
+[[nodiscard]] auto peak_rss_kib() -> long {
+    auto usage = rusage {};
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+    return usage.ru_maxrss;
+}
+
+auto run(const Arguments &arguments) -> void {
+    const auto face = create_face_from_file(arguments.font_file.c_str());
+    const auto font = create_font(face, arguments.font_size);
+    const auto corpus = read_corpus(arguments.corpus_file);
+    if (corpus.empty()) {
+        throw std::runtime_error("Corpus has no items");
+    }
+
+    if (!arguments.trace_file.empty()) {
+        set_trace_sink(std::make_shared<ChromeTraceWriter>(arguments.trace_file));
+    }
+    const auto run_result = run_workers(arguments, font, corpus);
+    set_trace_sink(nullptr);
+
+    const auto seconds = run_result.seconds;
+    const auto allocations = run_result.allocations;
+    const auto bytes = run_result.allocated_bytes;
+
+    auto total = WorkerResult {};
+    for (const auto &result : run_result.workers) {
+        total.glyphs += result.glyphs;
+        total.cache_hits += result.cache_hits;
+        total.cache_misses += result.cache_misses;
+        total.latencies.insert(total.latencies.end(), result.latencies.begin(),
+                               result.latencies.end());
+    }
+    std::ranges::sort(total.latencies);
+    const auto strings = total.latencies.size();
+
+    std::cout << "{\n"
+              << "  \"font\": " << json_string(arguments.font_file) << ",\n"
+              << "  \"corpus\": " << json_string(arguments.corpus_file) << ",\n"
+              << "  \"corpus_items\": " << corpus.size() << ",\n"
+              << "  \"iterations\": " << arguments.iterations << ",\n"
+              << "  \"threads\": " << arguments.threads << ",\n"
+              << "  \"batch_size\": " << arguments.batch_size << ",\n"
+              << "  \"cache_capacity\": " << arguments.cache_capacity << ",\n"
+              << "  \"render\": " << (arguments.render ? "true" : "false") << ",\n"
+              << "  \"backend\": \""
+              << format_name(backend_names, arguments.options.backend_policy) << "\",\n"
+              << "  \"quality\": \""
+              << format_name(quality_names, arguments.options.quality) << "\",\n"
+              << "  \"elapsed_seconds\": " << seconds << ",\n"
+              << "  \"strings\": " << strings << ",\n"
+              << "  \"glyphs\": " << total.glyphs << ",\n"
+              << "  \"strings_per_second\": " << strings / seconds << ",\n"
+              << "  \"glyphs_per_second\": " << total.glyphs / seconds << ",\n"
+              << "  \"latency_ns\": {\"p50\": " << percentile(total.latencies, 0.50)
+              << ", \"p99\": " << percentile(total.latencies, 0.99)
+              << ", \"max\": " << percentile(total.latencies, 1.0) << "},\n"
+              << "  \"peak_rss_kib\": " << peak_rss_kib() << ",\n"
+              << "  \"allocations\": " << allocations << ",\n"
+              << "  \"allocated_bytes\": " << bytes << ",\n"
+              << "  \"cache_hits\": " << total.cache_hits << ",\n"
+              << "  \"cache_misses\": " << total.cache_misses << "\n"
+              << "}\n";
+}
+
+}  // namespace
+
+auto main(int argc, char *argv[]) -> int {
+    try {
+        run(parse_arguments(std::span {argv, static_cast<std::size_t>(argc)}));
+    } catch (const std::runtime_error &exc) {
+        std::cerr << "Exception: " << exc.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,116 @@
+#ifndef BLEND2D_SHAPING_TOOL_COMMON_H
+#define BLEND2D_SHAPING_TOOL_COMMON_H
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "blend2d_shaping.h"
+
+// helpers of the command line tools
+namespace blend2d_shaping::tool_common {
+
+[[nodiscard]] inline auto parse_count(std::string_view value) -> std::size_t {
+    const auto *last = value.data() + value.size();
+    auto result = std::size_t {};
+    const auto [ptr, ec] = std::from_chars(value.data(), last, result);
+    if (ec != std::errc {} || ptr != last) {
+        throw std::runtime_error("Invalid number " + std::string {value});
+    }
+    return result;
+}
+
+// non-empty lines of the file
+[[nodiscard]] inline auto read_corpus(const std::string &filename)
+    -> std::vector<std::string> {
+    auto file = std::ifstream {filename};
+    if (!file) {
+        throw std::runtime_error("Unable to open corpus " + filename);
+    }
+
+    auto result = std::vector<std::string> {};
+    for (auto line = std::string {}; std::getline(file, line);) {
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        if (!line.empty()) {
+            result.push_back(std::move(line));
+        }
+    }
+    return result;
+}
+
+inline constexpr auto backend_names = std::array {
+    std::pair {std::string_view {"automatic"}, ShapingBackendPolicy::automatic},
+    std::pair {std::string_view {"harfbuzz"}, ShapingBackendPolicy::harfbuzz},
+    std::pair {std::string_view {"blend2d"}, ShapingBackendPolicy::blend2d},
+};
+
+inline constexpr auto quality_names = std::array {
+    std::pair {std::string_view {"full"}, ShapingQuality::full},
+    std::pair {std::string_view {"kerning_only"}, ShapingQuality::kerning_only},
+    std::pair {std::string_view {"nominal"}, ShapingQuality::nominal},
+    std::pair {std::string_view {"monospace"}, ShapingQuality::monospace},
+};
+
+template <typename T, std::size_t N>
+using NameTable = std::array<std::pair<std::string_view, T>, N>;
+
+template <typename T, std::size_t N>
+[[nodiscard]] auto parse_name(const NameTable<T, N> &names, std::string_view value)
+    -> T {
+    const auto entry = std::ranges::find_if(
+        names, [=](const auto &pair) { return pair.first == value; });
+    if (entry == names.end()) {
+        throw std::runtime_error("Unknown value " + std::string {value});
+    }
+    return entry->second;
+}
+
+template <typename T, std::size_t N>
+[[nodiscard]] auto format_name(const NameTable<T, N> &names, T value)
+    -> std::string_view {
+    const auto entry = std::ranges::find_if(
+        names, [=](const auto &pair) { return pair.second == value; });
+    return entry == names.end() ? std::string_view {"unknown"} : entry->first;
+}
+
+[[nodiscard]] inline auto json_string(std::string_view value) -> std::string {
+    auto result = std::string {"\""};
+
+    for (const auto c : value) {
+        switch (c) {
+            case '"':
+                result.append("\\\"");
+                break;
+            case '\\':
+                result.append("\\\\");
+                break;
+            case '\n':
+                result.append("\\n");
+                break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    // other control characters as \u00XX
+                    constexpr auto digits = std::string_view {"0123456789abcdef"};
+                    result.append("\\u00");
+                    result.push_back(digits[static_cast<unsigned char>(c) >> 4]);
+                    result.push_back(digits[static_cast<unsigned char>(c) & 0xF]);
+                } else {
+                    result.push_back(c);
+                }
+        }
+    }
+    result.push_back('"');
+    return result;
+}
+
+}  // namespace blend2d_shaping::tool_common
+
+#endif
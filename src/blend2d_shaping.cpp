@@ -1,12 +1,46 @@
 #include "blend2d_shaping.h"
 
+#include <hb-ot.h>
 #include <hb.h>
 
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
 #include <cassert>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <iomanip>
 #include <iterator>
+#include <limits>
+#include <mutex>
 #include <numeric>
+#include <optional>
+#include <ranges>
+#include <sstream>
 #include <stdexcept>
+#include <type_traits>
+#include <utility>
 
 namespace blend2d_shaping {
 
@@ -115,10 +149,30 @@ auto HbBufferDeleter::operator()(hb_buffer_t *hb_buffer) -> void {
     return face;
 }
 
-[[nodiscard]] auto create_immutable_face(std::span<const char> font_data,
-                                         unsigned int font_index) -> HbFacePointer {
-    const auto blob = create_hb_blob(font_data);
+// references the data of the array, which keeps it alive, instead of copying it
+[[nodiscard]] auto create_hb_blob(const BLArray<uint8_t> &font_data) -> HbBlobPointer {
+    const auto *data = reinterpret_cast<const char *>(font_data.data());
+    const auto length = narrow<unsigned int>(font_data.size());
+    const auto mode = hb_memory_mode_t::HB_MEMORY_MODE_READONLY;
+
+    // Blend2D arrays are reference counted, so the copy shares the data
+    auto reference = std::make_unique<BLArray<uint8_t>>(font_data);
+    const auto destroy = [](void *user_data) {
+        delete static_cast<BLArray<uint8_t> *>(user_data);
+    };
+
+    auto blob = HbBlobPointer {
+        hb_blob_create(data, length, mode, reference.release(), destroy),
+    };
 
+    expects(blob != nullptr);
+    expects(hb_blob_get_length(blob.get()) == length);
+
+    return blob;
+}
+
+[[nodiscard]] auto create_immutable_face(const HbBlobPointer &blob,
+                                         unsigned int font_index) -> HbFacePointer {
     auto face = HbFacePointer {hb_face_create(blob.get(), font_index)};
     hb_face_make_immutable(face.get());
 
@@ -140,29 +194,335 @@ auto HbBufferDeleter::operator()(hb_buffer_t *hb_buffer) -> void {
     return font;
 }
 
-[[nodiscard]] auto shape_text(std::string_view text_utf8, hb_font_t *hb_font)
-    -> HbBufferPointer {
-    expects(hb_font != nullptr);
+//
+// Instrumentation
+//
 
-    auto buffer = HbBufferPointer {hb_buffer_create()};
-    expects(buffer != nullptr);
+#ifdef BLEND2D_SHAPING_INSTRUMENTATION
+constexpr auto instrumentation_compiled = true;
+#else
+constexpr auto instrumentation_compiled = false;
+#endif
+
+using InstrumentationClock = std::chrono::steady_clock;
+
+// written only by the owning thread, atomic so snapshots can read them
+struct StageCounters {
+    std::atomic<uint64_t> count {};
+    std::atomic<uint64_t> total_ns {};
+    std::array<std::atomic<uint64_t>, latency_bucket_count> histogram {};
+};
+
+struct ThreadCounters {
+    std::array<StageCounters, shaping_stage_count> stages {};
+    std::atomic<uint64_t> shaped_texts {};
+    std::atomic<uint64_t> glyphs {};
+};
+
+// counters have a single writer, so no read-modify-write is needed
+auto increment(std::atomic<uint64_t> &counter, uint64_t value) -> void {
+    counter.store(counter.load(std::memory_order_relaxed) + value,
+                  std::memory_order_relaxed);
+}
+
+auto add_counters(InstrumentationSnapshot &snapshot, const ThreadCounters &counters)
+    -> void {
+    for (std::size_t i = 0; i < shaping_stage_count; ++i) {
+        auto &stage = snapshot.stages[i];
+        const auto &counter = counters.stages[i];
+
+        stage.count += counter.count.load(std::memory_order_relaxed);
+        stage.total_ns += counter.total_ns.load(std::memory_order_relaxed);
+        for (std::size_t j = 0; j < latency_bucket_count; ++j) {
+            stage.histogram[j] += counter.histogram[j].load(std::memory_order_relaxed);
+        }
+    }
+    snapshot.shaped_texts += counters.shaped_texts.load(std::memory_order_relaxed);
+    snapshot.glyphs += counters.glyphs.load(std::memory_order_relaxed);
+}
+
+// counters of all live threads, and the sum of those that exited
+class CounterRegistry {
+   public:
+    auto add(const ThreadCounters *counters) -> void {
+        const auto lock = std::scoped_lock {mutex_};
+        threads_.push_back(counters);
+    }
+
+    auto remove(const ThreadCounters *counters) -> void {
+        const auto lock = std::scoped_lock {mutex_};
+        add_counters(retired_, *counters);
+        std::erase(threads_, counters);
+    }
+
+    [[nodiscard]] auto snapshot() -> InstrumentationSnapshot {
+        const auto lock = std::scoped_lock {mutex_};
+
+        auto result = retired_;
+        for (const auto *counters : threads_) {
+            add_counters(result, *counters);
+        }
+        return result;
+    }
+
+   private:
+    std::mutex mutex_ {};
+    std::vector<const ThreadCounters *> threads_ {};
+    InstrumentationSnapshot retired_ {};
+};
+
+[[nodiscard]] auto counter_registry() -> CounterRegistry & {
+    static auto registry = CounterRegistry {};
+    return registry;
+}
+
+class ThreadRegistration {
+   public:
+    explicit ThreadRegistration() {
+        counter_registry().add(&counters);
+    }
+
+    ~ThreadRegistration() {
+        counter_registry().remove(&counters);
+    }
+
+    ThreadRegistration(const ThreadRegistration &) = delete;
+    ThreadRegistration(ThreadRegistration &&) = delete;
+    auto operator=(const ThreadRegistration &) -> ThreadRegistration & = delete;
+    auto operator=(ThreadRegistration &&) -> ThreadRegistration & = delete;
+
+    ThreadCounters counters {};
+};
+
+[[nodiscard]] auto thread_counters() -> ThreadCounters & {
+    thread_local ThreadRegistration registration {};
+    return registration.counters;
+}
+
+// bucket i counts latencies in [2^i, 2^(i+1)) nanoseconds
+[[nodiscard]] auto latency_bucket(uint64_t nanoseconds) -> std::size_t {
+    const auto width = static_cast<std::size_t>(std::bit_width(nanoseconds));
+    return std::min(width == 0 ? 0 : width - 1, latency_bucket_count - 1);
+}
+
+auto record_stage(ShapingStage stage, InstrumentationClock::duration elapsed) -> void {
+    const auto nanoseconds = static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+    auto &counters = thread_counters().stages[static_cast<std::size_t>(stage)];
+
+    increment(counters.count, 1);
+    increment(counters.total_ns, nanoseconds);
+    increment(counters.histogram[latency_bucket(nanoseconds)], 1);
+}
+
+auto record_shaped_text(std::size_t glyph_count) -> void {
+    if constexpr (instrumentation_compiled) {
+        auto &counters = thread_counters();
+        increment(counters.shaped_texts, 1);
+        increment(counters.glyphs, glyph_count);
+    }
+}
+
+// records the lifetime of the timer for the stage, does nothing if compiled out
+class StageTimer {
+   public:
+    explicit StageTimer(ShapingStage stage) {
+        if constexpr (instrumentation_compiled) {
+            stage_ = stage;
+            start_ = InstrumentationClock::now();
+        }
+    }
+
+    ~StageTimer() {
+        if constexpr (instrumentation_compiled) {
+            record_stage(stage_, InstrumentationClock::now() - start_);
+        }
+    }
+
+    StageTimer(const StageTimer &) = delete;
+    StageTimer(StageTimer &&) = delete;
+    auto operator=(const StageTimer &) -> StageTimer & = delete;
+    auto operator=(StageTimer &&) -> StageTimer & = delete;
+
+   private:
+    ShapingStage stage_ {};
+    InstrumentationClock::time_point start_ {};
+};
+
+//
+// Tracing
+//
+
+#ifdef BLEND2D_SHAPING_TRACING
+constexpr auto tracing_compiled = true;
+#else
+constexpr auto tracing_compiled = false;
+#endif
+
+// events buffered per thread before they are handed to the sink
+constexpr auto trace_buffer_capacity = std::size_t {1024};
+
+// checked by every span, so disabled tracing costs a relaxed load
+std::atomic<bool> tracing_active {false};
+std::atomic<uint64_t> next_trace_thread_id {1};
+// incremented with every sink change, buffered events of older sinks are stale
+std::atomic<uint64_t> trace_generation {0};
+
+struct TraceState {
+    std::mutex mutex {};
+    std::shared_ptr<TraceSink> sink {};
+};
+
+[[nodiscard]] auto trace_state() -> TraceState & {
+    static auto state = TraceState {};
+    return state;
+}
+
+// null if the sink was replaced since the generation
+[[nodiscard]] auto current_trace_sink(uint64_t generation)
+    -> std::shared_ptr<TraceSink> {
+    auto &state = trace_state();
+    const auto lock = std::scoped_lock {state.mutex};
+    if (generation != trace_generation.load(std::memory_order_relaxed)) {
+        return nullptr;
+    }
+    return state.sink;
+}
+
+[[nodiscard]] auto trace_clock_ns() -> int64_t {
+    static const auto epoch = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now() - epoch)
+        .count();
+}
+
+class ThreadTraceBuffer {
+   public:
+    explicit ThreadTraceBuffer() {
+        // constructed first, so the state outlives the buffer of the main thread
+        static_cast<void>(trace_state());
+        events_.reserve(trace_buffer_capacity);
+    }
+
+    ~ThreadTraceBuffer() {
+        flush();
+    }
+
+    ThreadTraceBuffer(const ThreadTraceBuffer &) = delete;
+    ThreadTraceBuffer(ThreadTraceBuffer &&) = delete;
+    auto operator=(const ThreadTraceBuffer &) -> ThreadTraceBuffer & = delete;
+    auto operator=(ThreadTraceBuffer &&) -> ThreadTraceBuffer & = delete;
+
+    [[nodiscard]] auto thread_id() const noexcept -> uint64_t {
+        return thread_id_;
+    }
+
+    auto add(const TraceEvent &event) -> void {
+        const auto generation = trace_generation.load(std::memory_order_relaxed);
+        if (generation != generation_) {
+            // recorded for a sink that was replaced
+            events_.clear();
+            generation_ = generation;
+        }
+
+        events_.push_back(event);
+        if (events_.size() >= trace_buffer_capacity) {
+            flush();
+        }
+    }
+
+    auto flush() -> void {
+        if (events_.empty()) {
+            return;
+        }
+        if (const auto sink = current_trace_sink(generation_)) {
+            sink->write(events_);
+        }
+        events_.clear();
+    }
+
+   private:
+    uint64_t thread_id_ {next_trace_thread_id.fetch_add(1, std::memory_order_relaxed)};
+    // of the sink the buffered events were recorded for
+    uint64_t generation_ {trace_generation.load(std::memory_order_relaxed)};
+    std::vector<TraceEvent> events_ {};
+};
+
+[[nodiscard]] auto thread_trace_buffer() -> ThreadTraceBuffer & {
+    thread_local ThreadTraceBuffer buffer {};
+    return buffer;
+}
+
+//
+// Harfbuzz Shaping
+//
+
+// converts into the given storage, keeping its capacity
+auto to_hb_features(std::span<const FontFeature> features,
+                    std::vector<hb_feature_t> &result) -> void {
+    result.clear();
+    std::ranges::transform(features, std::back_inserter(result),
+                           [](const FontFeature &feature) {
+                               return hb_feature_t {
+                                   .tag = hb_tag_t {feature.tag},
+                                   .value = feature.value,
+                                   .start = HB_FEATURE_GLOBAL_START,
+                                   .end = HB_FEATURE_GLOBAL_END,
+                               };
+                           });
+}
+
+[[nodiscard]] auto to_hb_features(std::span<const FontFeature> features)
+    -> std::vector<hb_feature_t> {
+    auto result = std::vector<hb_feature_t> {};
+    result.reserve(features.size());
+    to_hb_features(features, result);
+    return result;
+}
+
+auto setup_buffer(hb_buffer_t *buffer, std::string_view text_utf8,
+                  std::size_t item_offset, std::size_t item_length) -> void {
+    const auto timer = StageTimer {ShapingStage::buffer_setup};
+
+    hb_buffer_clear_contents(buffer);
 
     const auto text_length = narrow<int>(text_utf8.size());
-    const auto item_offset = std::size_t {0};
-    const auto item_length = text_length;
-    hb_buffer_add_utf8(buffer.get(), text_utf8.data(), text_length, item_offset,
-                       item_length);
+    hb_buffer_add_utf8(buffer, text_utf8.data(), text_length,
+                       narrow<unsigned int>(item_offset), narrow<int>(item_length));
+
+    // direction, script and language are guessed from the text, the guess
+    // keeps properties that are already set
+    hb_buffer_guess_segment_properties(buffer);
+
+    // retain which glyphs are unsafe to concatenate with other text
+    hb_buffer_set_flags(buffer, HB_BUFFER_FLAG_PRODUCE_UNSAFE_TO_CONCAT);
+}
 
-    // set text properties
-    hb_buffer_set_direction(buffer.get(), HB_DIRECTION_LTR);
-    hb_buffer_set_script(buffer.get(), HB_SCRIPT_LATIN);
-    hb_buffer_set_language(buffer.get(), hb_language_from_string("en", -1));
-    hb_buffer_guess_segment_properties(buffer.get());
+// shapes the item of the text into the reused buffer, the rest is context
+auto shape_text_item(hb_buffer_t *buffer, std::string_view text_utf8,
+                     std::size_t item_offset, std::size_t item_length,
+                     hb_font_t *hb_font, std::span<const hb_feature_t> hb_features = {})
+    -> void {
+    expects(buffer != nullptr);
+    expects(hb_font != nullptr);
+    expects(item_offset + item_length <= text_utf8.size());
+
+    setup_buffer(buffer, text_utf8, item_offset, item_length);
 
     // shape text
-    const hb_feature_t *features = nullptr;
-    const auto num_features = std::size_t {0};
-    hb_shape(hb_font, buffer.get(), features, num_features);
+    const auto timer = StageTimer {ShapingStage::shape};
+    hb_shape(hb_font, buffer, hb_features.data(),
+             narrow<unsigned int>(hb_features.size()));
+}
+
+[[nodiscard]] auto shape_text(std::string_view text_utf8, hb_font_t *hb_font,
+                              std::span<const FontFeature> features = {})
+    -> HbBufferPointer {
+    auto buffer = HbBufferPointer {hb_buffer_create()};
+    expects(buffer != nullptr);
+
+    shape_text_item(buffer.get(), text_utf8, 0, text_utf8.size(), hb_font,
+                    to_hb_features(features));
 
     return buffer;
 }
@@ -219,13 +579,65 @@ auto HbBufferDeleter::operator()(hb_buffer_t *hb_buffer) -> void {
     return result;
 }
 
-[[nodiscard]] auto calculate_bounding_rect(hb_buffer_t *hb_buffer, hb_font_t *hb_font,
-                                           float font_size) -> BLBox {
+[[nodiscard]] auto get_clusters(hb_buffer_t *hb_buffer) -> std::vector<uint32_t> {
     expects(hb_buffer != nullptr);
-    expects(hb_font != nullptr);
+    const auto glyph_infos = get_glyph_infos(hb_buffer);
+
+    auto result = std::vector<uint32_t> {};
+    result.reserve(glyph_infos.size());
+
+    std::ranges::transform(
+        glyph_infos, std::back_inserter(result),
+        [](const hb_glyph_info_t &glyph_info) { return glyph_info.cluster; });
+
+    return result;
+}
 
+[[nodiscard]] auto get_glyph_flags(hb_buffer_t *hb_buffer) -> std::vector<uint8_t> {
+    expects(hb_buffer != nullptr);
     const auto glyph_infos = get_glyph_infos(hb_buffer);
-    const auto glyph_positions = get_hb_glyph_positions(hb_buffer);
+
+    auto result = std::vector<uint8_t> {};
+    result.reserve(glyph_infos.size());
+
+    std::ranges::transform(glyph_infos, std::back_inserter(result),
+                           [](const hb_glyph_info_t &glyph_info) {
+                               return static_cast<uint8_t>(
+                                   hb_glyph_info_get_glyph_flags(&glyph_info));
+                           });
+
+    return result;
+}
+
+// ink box of the glyph at the pen origin in font units, y pointing down
+[[nodiscard]] auto get_glyph_box(hb_font_t *hb_font, uint32_t codepoint,
+                                 const BLPoint &origin, const BLGlyphPlacement &pos)
+    -> std::optional<BLBox> {
+    auto extents = hb_glyph_extents_t {};
+
+    if (hb_font_get_glyph_extents(hb_font, codepoint, &extents) == 0 ||
+        extents.width == 0 || extents.height == 0) {
+        return std::nullopt;
+    }
+
+    const auto glyph_rect = BLBox {
+        origin.x + pos.placement.x + extents.x_bearing,
+        -(origin.y + pos.placement.y + extents.y_bearing),
+        origin.x + pos.placement.x + extents.x_bearing + extents.width,
+        -(origin.y + pos.placement.y + extents.y_bearing + extents.height),
+    };
+
+    assert(glyph_rect.x0 <= glyph_rect.x1);
+    assert(glyph_rect.y0 <= glyph_rect.y1);
+
+    return glyph_rect;
+}
+
+[[nodiscard]] auto calculate_bounding_rect(std::span<const uint32_t> codepoints,
+                                           std::span<const BLGlyphPlacement> placements,
+                                           hb_font_t *hb_font, float font_size) -> BLBox {
+    expects(hb_font != nullptr);
+    const auto timer = StageTimer {ShapingStage::bounds};
 
     auto scale = BLPointI {};
     hb_font_get_scale(hb_font, &scale.x, &scale.y);
@@ -239,33 +651,21 @@ auto HbBufferDeleter::operator()(hb_buffer_t *hb_buffer) -> void {
     };
     bool found = false;
 
-    const auto N = std::min(glyph_infos.size(), glyph_positions.size());
+    const auto N = std::min(codepoints.size(), placements.size());
     for (std::size_t i = 0; i < N; ++i) {
-        const auto &pos = glyph_positions[i];
-        auto extents = hb_glyph_extents_t {};
-
-        if (hb_font_get_glyph_extents(hb_font, glyph_infos[i].codepoint, &extents) != 0 &&
-            extents.width != 0 && extents.height != 0) {
-            const auto glyph_rect = BLBox {
-                origin.x + pos.x_offset + extents.x_bearing,
-                -(origin.y + pos.y_offset + extents.y_bearing),
-                origin.x + pos.x_offset + extents.x_bearing + extents.width,
-                -(origin.y + pos.y_offset + extents.y_bearing + extents.height),
-            };
-
-            assert(glyph_rect.x0 <= glyph_rect.x1);
-            assert(glyph_rect.y0 <= glyph_rect.y1);
+        const auto &pos = placements[i];
 
-            rect.x0 = std::min(rect.x0, glyph_rect.x0);
-            rect.y0 = std::min(rect.y0, glyph_rect.y0);
-            rect.x1 = std::max(rect.x1, glyph_rect.x1);
-            rect.y1 = std::max(rect.y1, glyph_rect.y1);
+        if (const auto glyph_rect = get_glyph_box(hb_font, codepoints[i], origin, pos)) {
+            rect.x0 = std::min(rect.x0, glyph_rect->x0);
+            rect.y0 = std::min(rect.y0, glyph_rect->y0);
+            rect.x1 = std::max(rect.x1, glyph_rect->x1);
+            rect.y1 = std::max(rect.y1, glyph_rect->y1);
 
             found = true;
         }
 
-        origin.x += pos.x_advance;
-        origin.y += pos.y_advance;
+        origin.x += pos.advance.x;
+        origin.y += pos.advance.y;
     }
 
     if (!found || scale.x == 0 || scale.y == 0) {
@@ -275,122 +675,3821 @@ auto HbBufferDeleter::operator()(hb_buffer_t *hb_buffer) -> void {
     return rect / scale * font_size;
 }
 
-}  // namespace
+[[nodiscard]] auto get_codepoints(const BLGlyphRun &glyph_run)
+    -> std::span<const uint32_t> {
+    if (glyph_run.size == 0) {
+        return {};
+    }
+    expects(glyph_run.glyphAdvance == sizeof(uint32_t));
+    return std::span<const uint32_t>(static_cast<const uint32_t *>(glyph_run.glyphData),
+                                     glyph_run.size);
+}
 
-//
-// Font Face
-//
+[[nodiscard]] auto get_placements(const BLGlyphRun &glyph_run)
+    -> std::span<const BLGlyphPlacement> {
+    if (glyph_run.size == 0) {
+        return {};
+    }
+    expects(glyph_run.placementAdvance == sizeof(BLGlyphPlacement));
+    return std::span<const BLGlyphPlacement>(
+        static_cast<const BLGlyphPlacement *>(glyph_run.placementData), glyph_run.size);
+}
 
-HbFontFace::HbFontFace() : face_ {create_immutable_face()} {
-    expects(face_ != nullptr);
-    ensures(hb_face_is_immutable(face_.get()));
+// heap bytes of the string, zero if stored inline
+[[nodiscard]] auto heap_usage(const std::string &value) -> std::size_t {
+    const auto *object = reinterpret_cast<const char *>(&value);
+    const auto is_inline =
+        value.data() >= object && value.data() < object + sizeof(std::string);
+    return is_inline ? 0 : value.capacity() + 1;
 }
 
-HbFontFace::HbFontFace(std::span<const char> font_data, unsigned int font_index)
-    : face_ {create_immutable_face(font_data, font_index)} {
-    ensures(face_ != nullptr);
-    ensures(hb_face_is_immutable(face_.get()));
+template <typename T>
+[[nodiscard]] auto heap_usage(const std::vector<T> &value) -> std::size_t {
+    return value.capacity() * sizeof(T);
 }
 
-namespace {
+[[nodiscard]] auto make_glyph_run(std::span<const uint32_t> codepoints,
+                                  std::span<const BLGlyphPlacement> placements)
+    -> BLGlyphRun {
+    expects(codepoints.size() == placements.size());
 
-[[nodiscard]] auto to_char_span(std::span<const uint8_t> span) -> std::span<const char> {
-    return std::span<const char>(reinterpret_cast<const char *>(span.data()),
-                                 span.size());
+    auto result = BLGlyphRun {};
+
+    result.size = codepoints.size();
+    result.setGlyphData(codepoints.data());
+    result.setPlacementData(placements.data());
+    result.placementType = BL_GLYPH_PLACEMENT_TYPE_ADVANCE_OFFSET;
+
+    return result;
 }
 
-}  // namespace
+// writes the shaped glyphs into storage sized to the glyph count, returns the advance
+auto extract_glyphs(hb_buffer_t *buffer, std::span<uint32_t> codepoints,
+                    std::span<BLGlyphPlacement> placements, std::span<uint32_t> clusters)
+    -> BLPointI {
+    const auto timer = StageTimer {ShapingStage::glyph_extraction};
 
-HbFontFace::HbFontFace(std::span<const uint8_t> font_data, unsigned int font_index)
-    : HbFontFace {to_char_span(font_data), font_index} {}
+    const auto glyph_infos = get_glyph_infos(buffer);
+    const auto glyph_positions = get_hb_glyph_positions(buffer);
+    expects(glyph_infos.size() == glyph_positions.size());
+    expects(codepoints.size() == glyph_infos.size());
+    expects(placements.size() == glyph_infos.size());
+    expects(clusters.size() == glyph_infos.size());
 
-auto HbFontFace::empty() const -> bool {
-    return hb_face_get_glyph_count(hb_face()) == 0;
-}
+    auto advance = BLPointI {};
 
-auto HbFontFace::hb_face() const noexcept -> hb_face_t * {
-    expects(face_ != nullptr);
-    ensures(hb_face_is_immutable(face_.get()));
+    for (std::size_t i = 0; i < glyph_infos.size(); ++i) {
+        const auto &info = glyph_infos[i];
+        const auto &position = glyph_positions[i];
 
-    return face_.get();
-}
+        codepoints[i] = info.codepoint;
+        placements[i] = BLGlyphPlacement {
+            .placement = BLPointI {position.x_offset, position.y_offset},
+            .advance = BLPointI {position.x_advance, position.y_advance},
+        };
+        clusters[i] = info.cluster;
 
-//
-// Font
-//
+        advance.x += position.x_advance;
+        advance.y += position.y_advance;
+    }
 
-HbFont::HbFont() : font_ {create_immutable_font()} {
-    ensures(font_ != nullptr);
-    ensures(hb_font_is_immutable(font_.get()));
+    return advance;
 }
 
-HbFont::HbFont(const HbFontFace &face) : font_ {create_immutable_font(face.hb_face())} {
-    ensures(font_ != nullptr);
-    ensures(hb_font_is_immutable(font_.get()));
-}
+[[nodiscard]] auto units_to_pixels(hb_font_t *hb_font, float font_size) -> BLPoint {
+    expects(hb_font != nullptr);
 
-auto HbFont::empty() const -> bool {
-    const auto *face = hb_font_get_face(hb_font());
-    expects(face != nullptr);
+    auto scale = BLPointI {};
+    hb_font_get_scale(hb_font, &scale.x, &scale.y);
 
-    return hb_face_get_glyph_count(face) == 0;
+    if (scale.x == 0 || scale.y == 0) {
+        return BLPoint {};
+    }
+    return BLPoint {font_size / static_cast<double>(scale.x),
+                   font_size / static_cast<double>(scale.y)};
 }
 
-auto HbFont::hb_font() const noexcept -> hb_font_t * {
-    expects(font_ != nullptr);
-    ensures(hb_font_is_immutable(font_.get()));
-
-    return font_.get();
+[[nodiscard]] auto merge_boxes(const BLBox &a, const BLBox &b) -> BLBox {
+    // empty boxes have no ink
+    if (a == BLBox {}) {
+        return b;
+    }
+    if (b == BLBox {}) {
+        return a;
+    }
+    return BLBox {
+        std::min(a.x0, b.x0),
+        std::min(a.y0, b.y0),
+        std::max(a.x1, b.x1),
+        std::max(a.y1, b.y1),
+    };
 }
 
+constexpr auto unsafe_glyph_flags =
+    uint8_t {HB_GLYPH_FLAG_UNSAFE_TO_BREAK | HB_GLYPH_FLAG_UNSAFE_TO_CONCAT};
+
+}  // namespace
+
 //
-// Shaped Text
+// Backend Shaping
 //
 
-HbShapedText::HbShapedText(std::string_view text_utf8, const HbFont &font,
-                           float font_size) {
-    const auto buffer = shape_text(text_utf8, font.hb_font());
+namespace detail {
 
-    codepoints_ = get_uint32_codepoints(buffer.get());
-    placements_ = get_bl_placements(buffer.get());
-    bounding_box_ = calculate_bounding_rect(buffer.get(), font.hb_font(), font_size);
+struct ShapedGlyphs {
+    std::vector<uint32_t> codepoints {};
+    std::vector<BLGlyphPlacement> placements {};
+    std::vector<uint32_t> clusters {};
+    std::vector<uint8_t> glyph_flags {};
+};
 
-    ensures(codepoints_.size() == placements_.size());
+}  // namespace detail
+
+namespace {
+
+using detail::ShapedGlyphs;
+
+[[nodiscard]] auto shape_text_harfbuzz(std::string_view text_utf8, hb_font_t *hb_font,
+                                       std::span<const FontFeature> features)
+    -> ShapedGlyphs {
+    const auto buffer = shape_text(text_utf8, hb_font, features);
+    const auto timer = StageTimer {ShapingStage::glyph_extraction};
+
+    return ShapedGlyphs {
+        .codepoints = get_uint32_codepoints(buffer.get()),
+        .placements = get_bl_placements(buffer.get()),
+        .clusters = get_clusters(buffer.get()),
+        .glyph_flags = get_glyph_flags(buffer.get()),
+    };
 }
 
-auto HbShapedText::empty() const -> bool {
-    expects(codepoints_.size() == placements_.size());
+auto set_utf8_text(BLGlyphBuffer &buffer, std::string_view text_utf8) -> void {
+    const auto timer = StageTimer {ShapingStage::buffer_setup};
 
-    return codepoints_.empty();
+    if (const auto result = buffer.setUtf8Text(text_utf8.data(), text_utf8.size());
+        result != BL_SUCCESS) {
+        throw std::runtime_error("Unable to set text of BLGlyphBuffer");
+    }
 }
 
-auto HbShapedText::glyph_run() const noexcept -> BLGlyphRun {
-    expects(codepoints_.size() == placements_.size());
+[[nodiscard]] auto get_shaped_glyphs(const BLGlyphBuffer &buffer) -> ShapedGlyphs {
+    const auto timer = StageTimer {ShapingStage::glyph_extraction};
+    const auto glyph_count = buffer.size();
+    if (glyph_count == 0) {
+        return ShapedGlyphs {};
+    }
+    expects(buffer.placementData() != nullptr);
 
-    auto result = BLGlyphRun {};
+    const auto glyphs = std::span<const uint32_t>(buffer.content(), glyph_count);
+    const auto placements =
+        std::span<const BLGlyphPlacement>(buffer.placementData(), glyph_count);
+    const auto infos = std::span<const BLGlyphInfo>(buffer.infoData(), glyph_count);
 
-    result.size = codepoints_.size();
-    result.setGlyphData(codepoints_.data());
-    result.setPlacementData(placements_.data());
-    result.placementType = BL_GLYPH_PLACEMENT_TYPE_ADVANCE_OFFSET;
+    auto result = ShapedGlyphs {
+        .codepoints = std::vector<uint32_t>(glyphs.begin(), glyphs.end()),
+        .placements = std::vector<BLGlyphPlacement>(placements.begin(), placements.end()),
+        .clusters = std::vector<uint32_t> {},
+        .glyph_flags = std::vector<uint8_t> {},
+    };
 
-    return result;
-}
+    result.clusters.reserve(glyph_count);
+    std::ranges::transform(infos, std::back_inserter(result.clusters),
+                           [](const BLGlyphInfo &info) { return info.cluster; });
 
-auto HbShapedText::bounding_box() const noexcept -> BLBox {
-    return bounding_box_;
+    return result;
 }
 
-auto HbShapedText::bounding_rect() const noexcept -> BLRect {
-    const auto box = bounding_box_;
-    return BLRect {box.x0, box.y0, box.x1 - box.x0, box.y1 - box.y0};
-}
+[[nodiscard]] auto decode_utf8(std::string_view text_utf8, std::size_t &position)
+    -> uint32_t;
 
-//
-// From File
+/**
+ * @brief Derives glyph flags for Blend2D results, which doesn't report them.
+ *
+ * Substituted or repositioned glyphs and the glyphs after them are unsafe to
+ * break. The text ends aren't flagged, they are edges of the buffer and not
+ * seams, and splicing reshapes the glyphs next to them anyway.
+ */
+[[nodiscard]] auto derive_glyph_flags(std::span<const uint32_t> codepoints,
+                                      std::span<const BLGlyphPlacement> placements,
+                                      std::span<const uint32_t> clusters,
+                                      std::string_view text_utf8, hb_font_t *hb_font)
+    -> std::vector<uint8_t> {
+    expects(hb_font != nullptr);
+    expects(codepoints.size() == placements.size());
+    expects(codepoints.size() == clusters.size());
+
+    const auto count = codepoints.size();
+    auto result = std::vector<uint8_t>(count);
+    if (count == 0) {
+        return result;
+    }
+
+    auto nominal_advances = std::vector<hb_position_t>(count);
+    hb_font_get_glyph_h_advances(hb_font, narrow<unsigned int>(count), codepoints.data(),
+                                 unsigned {sizeof(uint32_t)}, nominal_advances.data(),
+                                 unsigned {sizeof(hb_position_t)});
+
+    for (std::size_t i = 0; i < count; ++i) {
+        const auto cluster_end =
+            i + 1 < count ? std::size_t {clusters[i + 1]} : text_utf8.size();
+
+        auto position = std::size_t {clusters[i]};
+        auto nominal_glyph = hb_codepoint_t {0};
+        const auto has_nominal =
+            position < text_utf8.size() &&
+            hb_font_get_nominal_glyph(hb_font, decode_utf8(text_utf8, position),
+                                      &nominal_glyph) != 0;
+
+        const auto &placement = placements[i];
+        const auto substituted =
+            !has_nominal || nominal_glyph != codepoints[i] || position != cluster_end;
+        const auto repositioned = placement.advance.x != nominal_advances[i] ||
+                                  placement.advance.y != 0 ||
+                                  placement.placement != BLPointI {};
+
+        // kerning can move either glyph of the pair
+        if (substituted || repositioned) {
+            result[i] |= unsafe_glyph_flags;
+            if (i + 1 < count) {
+                result[i + 1] |= unsafe_glyph_flags;
+            }
+        }
+    }
+
+    return result;
+}
+
+// flags are only derived for texts that are edited, plain shaping skips the
+// cost, returns true if they were missing
+auto derive_missing_glyph_flags(ShapedGlyphs &glyphs, std::string_view text_utf8,
+                                hb_font_t *hb_font) -> bool {
+    if (glyphs.glyph_flags.size() == glyphs.codepoints.size()) {
+        return false;
+    }
+    glyphs.glyph_flags = derive_glyph_flags(glyphs.codepoints, glyphs.placements,
+                                            glyphs.clusters, text_utf8, hb_font);
+    return true;
+}
+
+[[nodiscard]] auto shape_text_blend2d(std::string_view text_utf8, const Font &font)
+    -> ShapedGlyphs {
+    expects(!font.bl_font.empty());
+
+    BLGlyphBuffer buffer;
+    set_utf8_text(buffer, text_utf8);
+
+    {
+        const auto timer = StageTimer {ShapingStage::shape};
+        if (const auto result = font.bl_font.shape(buffer); result != BL_SUCCESS) {
+            throw std::runtime_error("Unable to shape text with BLFont");
+        }
+    }
+
+    return get_shaped_glyphs(buffer);
+}
+
+[[nodiscard]] auto shape_text_kerning_only(std::string_view text_utf8, const Font &font)
+    -> ShapedGlyphs {
+    expects(!font.bl_font.empty());
+
+    BLGlyphBuffer buffer;
+    set_utf8_text(buffer, text_utf8);
+
+    // glyph mapping and positioning without the substitution stage of BLFont::shape
+    {
+        const auto timer = StageTimer {ShapingStage::shape};
+        if (const auto result = font.bl_font.mapTextToGlyphs(buffer);
+            result != BL_SUCCESS) {
+            throw std::runtime_error("Unable to map text to glyphs with BLFont");
+        }
+        if (const auto result = font.bl_font.positionGlyphs(buffer);
+            result != BL_SUCCESS) {
+            throw std::runtime_error("Unable to position glyphs with BLFont");
+        }
+    }
+
+    return get_shaped_glyphs(buffer);
+}
+
+/**
+ * @brief Decodes the UTF-8 sequence at position and advances it.
+ *
+ * Invalid sequences are decoded as U+FFFD, like HarfBuzz does.
+ */
+[[nodiscard]] auto decode_utf8(std::string_view text_utf8, std::size_t &position)
+    -> uint32_t {
+    expects(position < text_utf8.size());
+
+    constexpr auto replacement_character = uint32_t {0xFFFD};
+    const auto lead = static_cast<uint8_t>(text_utf8[position++]);
+
+    if (lead < 0x80) {
+        return lead;
+    }
+
+    auto length = std::size_t {0};
+    auto codepoint = uint32_t {0};
+    auto minimum = uint32_t {0};
+    if ((lead & 0xE0) == 0xC0) {
+        length = 1;
+        codepoint = lead & 0x1F;
+        minimum = 0x80;
+    } else if ((lead & 0xF0) == 0xE0) {
+        length = 2;
+        codepoint = lead & 0x0F;
+        minimum = 0x800;
+    } else if ((lead & 0xF8) == 0xF0) {
+        length = 3;
+        codepoint = lead & 0x07;
+        minimum = 0x10000;
+    } else {
+        return replacement_character;
+    }
+
+    for (std::size_t i = 0; i < length; ++i) {
+        if (position >= text_utf8.size()) {
+            return replacement_character;
+        }
+        const auto next = static_cast<uint8_t>(text_utf8[position]);
+        if ((next & 0xC0) != 0x80) {
+            return replacement_character;
+        }
+        codepoint = (codepoint << 6) | (next & 0x3F);
+        ++position;
+    }
+
+    if (codepoint < minimum || codepoint > 0x10FFFF ||
+        (codepoint >= 0xD800 && codepoint <= 0xDFFF)) {
+        return replacement_character;
+    }
+    return codepoint;
+}
+
+/**
+ * @brief Decodes the text and stores the byte offset of each codepoint.
+ */
+[[nodiscard]] auto decode_utf8(std::string_view text_utf8, std::vector<uint32_t> &offsets)
+    -> std::vector<uint32_t> {
+    auto result = std::vector<uint32_t> {};
+    result.reserve(text_utf8.size());
+    offsets.clear();
+    offsets.reserve(text_utf8.size());
+
+    auto position = std::size_t {0};
+    while (position < text_utf8.size()) {
+        offsets.push_back(narrow<uint32_t>(position));
+        result.push_back(decode_utf8(text_utf8, position));
+    }
+
+    return result;
+}
+
+/**
+ * @brief Maps codepoints through cmap and reads advances from hmtx.
+ *
+ * Uses the batch APIs of HarfBuzz, so no shape plan is involved. Unmapped
+ * codepoints use the .notdef glyph.
+ */
+// maps each unicode to its nominal glyph, .notdef if unmapped
+auto map_nominal_glyphs(hb_font_t *hb_font, std::span<const uint32_t> unicodes,
+                        std::span<uint32_t> glyphs) -> void {
+    expects(hb_font != nullptr);
+    expects(unicodes.size() == glyphs.size());
+
+    const auto count = narrow<unsigned int>(unicodes.size());
+    constexpr auto stride = unsigned {sizeof(uint32_t)};
+
+    auto mapped = unsigned {0};
+    while (mapped < count) {
+        mapped += hb_font_get_nominal_glyphs(hb_font, count - mapped, &unicodes[mapped],
+                                             stride, &glyphs[mapped], stride);
+        if (mapped < count) {
+            glyphs[mapped] = 0;
+            ++mapped;
+        }
+    }
+}
+
+[[nodiscard]] auto shape_text_nominal(std::string_view text_utf8, hb_font_t *hb_font)
+    -> ShapedGlyphs {
+    expects(hb_font != nullptr);
+
+    auto offsets = std::vector<uint32_t> {};
+    const auto unicodes = decode_utf8(text_utf8, offsets);
+    const auto count = narrow<unsigned int>(unicodes.size());
+
+    // nominal glyphs don't interact, so all are safe to break
+    auto result = ShapedGlyphs {
+        .codepoints = std::vector<uint32_t>(unicodes.size()),
+        .placements = std::vector<BLGlyphPlacement>(unicodes.size()),
+        .clusters = std::move(offsets),
+        .glyph_flags = std::vector<uint8_t>(unicodes.size()),
+    };
+    if (count == 0) {
+        return result;
+    }
+
+    map_nominal_glyphs(hb_font, unicodes, result.codepoints);
+
+    // advances are written directly into the placements
+    static_assert(sizeof(BLPointI::x) == sizeof(hb_position_t));
+    hb_font_get_glyph_h_advances(hb_font, count, result.codepoints.data(),
+                                 unsigned {sizeof(uint32_t)},
+                                 &result.placements.front().advance.x,
+                                 unsigned {sizeof(BLGlyphPlacement)});
+
+    return result;
+}
+
+//
+// Monospace
+//
+
+struct UnicodeRange {
+    uint32_t first {};
+    uint32_t last {};
+};
+
+// ranges checked for a uniform advance in fixed-pitch faces
+constexpr auto monospace_ranges = std::array {
+    // printable ASCII
+    UnicodeRange {0x0020, 0x007E},
+    // Latin-1 Supplement
+    UnicodeRange {0x00A0, 0x00FF},
+    // Box Drawing and Block Elements
+    UnicodeRange {0x2500, 0x259F},
+};
+
+[[nodiscard]] auto is_monospace_codepoint(uint32_t codepoint) -> bool {
+    return std::ranges::any_of(monospace_ranges, [=](const UnicodeRange &range) {
+        return range.first <= codepoint && codepoint <= range.last;
+    });
+}
+
+// isFixedPitch of the 'post' table, which is at byte offset 12 in all versions
+[[nodiscard]] auto is_post_fixed_pitch(hb_face_t *hb_face) -> bool {
+    const auto blob =
+        HbBlobPointer {hb_face_reference_table(hb_face, HB_TAG('p', 'o', 's', 't'))};
+
+    auto length = unsigned {0};
+    const auto *data = hb_blob_get_data(blob.get(), &length);
+
+    constexpr auto offset = std::size_t {12};
+    if (data == nullptr || length < offset + 4) {
+        return false;
+    }
+    return std::any_of(data + offset, data + offset + 4,
+                       [](char byte) { return byte != 0; });
+}
+
+/**
+ * @brief Returns the advance of all glyphs of a fixed-pitch face, zero otherwise.
+ *
+ * Requires the isFixedPitch flag and a uniform advance of all mapped glyphs
+ * in the checked ranges, as the flag alone is not reliable.
+ */
+[[nodiscard]] auto detect_fixed_advance(const HbFontFace &face) -> int32_t {
+    if (face.empty() || !is_post_fixed_pitch(face.hb_face())) {
+        return 0;
+    }
+
+    const auto font = HbFont {face};
+    auto advance = int32_t {0};
+
+    for (const auto &range : monospace_ranges) {
+        for (auto unicode = range.first; unicode <= range.last; ++unicode) {
+            auto glyph = hb_codepoint_t {};
+            if (hb_font_get_nominal_glyph(font.hb_font(), unicode, &glyph) == 0) {
+                continue;
+            }
+
+            const auto glyph_advance = hb_font_get_glyph_h_advance(font.hb_font(), glyph);
+            if (glyph_advance <= 0 || (advance != 0 && glyph_advance != advance)) {
+                return 0;
+            }
+            advance = glyph_advance;
+        }
+    }
+    return advance;
+}
+
+/**
+ * @brief Places nominal glyphs at the fixed advance of the font.
+ *
+ * Only glyph mapping remains, positions are not looked up. Falls back to
+ * nominal shaping for proportional fonts and characters outside the checked
+ * ranges, whose advance might differ.
+ */
+[[nodiscard]] auto shape_text_monospace(std::string_view text_utf8, const Font &font)
+    -> ShapedGlyphs {
+    auto *hb_font = font.hb_font.hb_font();
+
+    auto offsets = std::vector<uint32_t> {};
+    const auto unicodes = decode_utf8(text_utf8, offsets);
+
+    if (font.fixed_advance == 0 ||
+        !std::ranges::all_of(unicodes, is_monospace_codepoint)) {
+        return shape_text_nominal(text_utf8, hb_font);
+    }
+
+    auto result = ShapedGlyphs {
+        .codepoints = std::vector<uint32_t>(unicodes.size()),
+        .placements = std::vector<BLGlyphPlacement>(
+            unicodes.size(), BLGlyphPlacement {
+                                 .placement = BLPointI {},
+                                 .advance = BLPointI {font.fixed_advance, 0},
+                             }),
+        .clusters = std::move(offsets),
+        .glyph_flags = std::vector<uint8_t>(unicodes.size()),
+    };
+    map_nominal_glyphs(hb_font, unicodes, result.codepoints);
+
+    return result;
+}
+
+/**
+ * @brief Returns true if the codepoint can be shaped without complex shaping.
+ *
+ * Marks and format characters need mark positioning or joining behavior
+ * only implemented by HarfBuzz.
+ */
+[[nodiscard]] auto is_simple_codepoint(hb_unicode_funcs_t *unicode_funcs,
+                                       uint32_t codepoint) -> bool {
+    switch (hb_unicode_general_category(unicode_funcs, codepoint)) {
+        case HB_UNICODE_GENERAL_CATEGORY_NON_SPACING_MARK:
+        case HB_UNICODE_GENERAL_CATEGORY_SPACING_MARK:
+        case HB_UNICODE_GENERAL_CATEGORY_ENCLOSING_MARK:
+        case HB_UNICODE_GENERAL_CATEGORY_FORMAT:
+            return false;
+        default:
+            break;
+    }
+
+    switch (hb_unicode_script(unicode_funcs, codepoint)) {
+        case HB_SCRIPT_COMMON:
+        case HB_SCRIPT_LATIN:
+        case HB_SCRIPT_GREEK:
+        case HB_SCRIPT_CYRILLIC:
+            return true;
+        default:
+            return false;
+    }
+}
+
+[[nodiscard]] auto is_simple_text(std::string_view text_utf8) -> bool {
+    auto *unicode_funcs = hb_unicode_funcs_get_default();
+
+    auto position = std::size_t {0};
+    while (position < text_utf8.size()) {
+        // ASCII is always simple
+        if (static_cast<uint8_t>(text_utf8[position]) < 0x80) {
+            ++position;
+            continue;
+        }
+        if (!is_simple_codepoint(unicode_funcs, decode_utf8(text_utf8, position))) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+[[nodiscard]] auto resolve_backend(std::string_view text_utf8,
+                                   const ShapingOptions &options) -> ShapingBackend {
+    switch (options.backend_policy) {
+        case ShapingBackendPolicy::harfbuzz:
+        case ShapingBackendPolicy::parity_check:
+            return ShapingBackend::harfbuzz;
+        case ShapingBackendPolicy::blend2d:
+            return options.features.empty() ? ShapingBackend::blend2d
+                                            : ShapingBackend::harfbuzz;
+        case ShapingBackendPolicy::automatic:
+            return select_shaping_backend(text_utf8, options);
+    }
+    std::terminate();
+}
+
+[[nodiscard]] auto shape_glyphs_direct(std::string_view text_utf8, const Font &font,
+                                       const ShapingOptions &options) -> ShapedGlyphs {
+    // Blend2D and the lighter qualities would silently drop the features
+    if (!options.features.empty()) {
+        return shape_text_harfbuzz(text_utf8, font.hb_font.hb_font(), options.features);
+    }
+
+    switch (options.quality) {
+        case ShapingQuality::full:
+            break;
+        case ShapingQuality::kerning_only:
+            return shape_text_kerning_only(text_utf8, font);
+        case ShapingQuality::nominal:
+            return shape_text_nominal(text_utf8, font.hb_font.hb_font());
+        case ShapingQuality::monospace:
+            return shape_text_monospace(text_utf8, font);
+    }
+
+    if (options.backend_policy == ShapingBackendPolicy::parity_check) {
+        auto harfbuzz = shape_text_harfbuzz(text_utf8, font.hb_font.hb_font(), {});
+        const auto blend2d = shape_text_blend2d(text_utf8, font);
+
+        if (harfbuzz.codepoints != blend2d.codepoints ||
+            harfbuzz.placements != blend2d.placements ||
+            harfbuzz.clusters != blend2d.clusters) {
+            throw std::runtime_error("Blend2D and HarfBuzz shaping results differ");
+        }
+        return harfbuzz;
+    }
+
+    switch (resolve_backend(text_utf8, options)) {
+        case ShapingBackend::harfbuzz:
+            return shape_text_harfbuzz(text_utf8, font.hb_font.hb_font(),
+                                       options.features);
+        case ShapingBackend::blend2d:
+            return shape_text_blend2d(text_utf8, font);
+    }
+    std::terminate();
+}
+
+//
+// Repeated Text
+//
+
+// longest unit in bytes detected as a repeated pattern
+constexpr auto max_repeated_unit_size = std::size_t {16};
+// repetitions needed before tiling is cheaper than shaping the whole text
+constexpr auto min_repeated_count = std::size_t {8};
+// copies shaped to derive the tiles, the inner ones see repeated context
+constexpr auto repeated_sample_count = std::size_t {4};
+
+[[nodiscard]] auto repeat_text(std::string_view unit_utf8, std::size_t count)
+    -> std::string {
+    auto result = std::string {};
+    result.reserve(unit_utf8.size() * count);
+
+    for (std::size_t i = 0; i < count; ++i) {
+        result.append(unit_utf8);
+    }
+    return result;
+}
+
+// byte size of the shortest unit the text repeats, zero if there is none
+[[nodiscard]] auto find_repeated_unit(std::string_view text_utf8) -> std::size_t {
+    const auto max_size =
+        std::min(max_repeated_unit_size, text_utf8.size() / min_repeated_count);
+
+    for (std::size_t size = 1; size <= max_size; ++size) {
+        if (text_utf8.size() % size == 0 &&
+            text_utf8.substr(size) == text_utf8.substr(0, text_utf8.size() - size)) {
+            return size;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Shapes count copies of the unit from a sample of a few copies.
+ *
+ * The first and last copy are taken from the sample as they are, the inner
+ * ones are tiled. Returns nullopt if glyphs cross copies or the inner copies
+ * of the sample differ, as then the shaping context is longer than a copy.
+ */
+[[nodiscard]] auto shape_repeated(std::string_view unit_utf8, std::size_t count,
+                                  const Font &font, const ShapingOptions &options)
+    -> std::optional<ShapedGlyphs> {
+    expects(!unit_utf8.empty());
+    expects(count >= repeated_sample_count);
+
+    const auto sample = shape_glyphs_direct(
+        repeat_text(unit_utf8, repeated_sample_count), font, options);
+    const auto &clusters = sample.clusters;
+    if (!std::ranges::is_sorted(clusters)) {
+        return std::nullopt;
+    }
+
+    // first glyph of each copy, the cluster needs to start exactly at the copy
+    auto starts = std::array<std::size_t, repeated_sample_count + 1> {};
+    for (std::size_t copy = 0; copy < starts.size(); ++copy) {
+        const auto offset = copy * unit_utf8.size();
+        const auto glyph = std::ranges::lower_bound(clusters, offset);
+
+        const auto found = glyph != clusters.end() && *glyph == offset;
+        if (copy < repeated_sample_count && !found) {
+            return std::nullopt;
+        }
+        starts[copy] = narrow<std::size_t>(glyph - clusters.begin());
+    }
+
+    const auto tile_size = starts[2] - starts[1];
+    const auto inner_equal = [&](std::size_t i) {
+        const auto a = starts[1] + i;
+        const auto b = starts[2] + i;
+        return sample.codepoints[a] == sample.codepoints[b] &&
+               sample.placements[a] == sample.placements[b] &&
+               (sample.glyph_flags.empty() ||
+                sample.glyph_flags[a] == sample.glyph_flags[b]) &&
+               sample.clusters[a] + unit_utf8.size() == sample.clusters[b];
+    };
+    if (starts[3] - starts[2] != tile_size ||
+        !std::ranges::all_of(std::views::iota(std::size_t {0}, tile_size), inner_equal)) {
+        return std::nullopt;
+    }
+
+    auto result = ShapedGlyphs {};
+    const auto glyph_count = starts[1] + (count - 2) * tile_size +
+                             (starts[repeated_sample_count] - starts[3]);
+    result.codepoints.reserve(glyph_count);
+    result.placements.reserve(glyph_count);
+    result.clusters.reserve(glyph_count);
+    result.glyph_flags.reserve(sample.glyph_flags.empty() ? 0 : glyph_count);
+
+    // appends the glyphs of the sample copy as the given copy of the result
+    const auto append_copy = [&](std::size_t copy, std::size_t target) {
+        const auto first = starts[copy];
+        const auto last = starts[copy + 1];
+        const auto cluster_offset = narrow<uint32_t>((target - copy) * unit_utf8.size());
+
+        result.codepoints.insert(result.codepoints.end(),
+                                 sample.codepoints.begin() + first,
+                                 sample.codepoints.begin() + last);
+        result.placements.insert(result.placements.end(),
+                                 sample.placements.begin() + first,
+                                 sample.placements.begin() + last);
+        std::transform(clusters.begin() + first, clusters.begin() + last,
+                       std::back_inserter(result.clusters),
+                       [=](uint32_t cluster) { return cluster + cluster_offset; });
+        if (!sample.glyph_flags.empty()) {
+            result.glyph_flags.insert(result.glyph_flags.end(),
+                                      sample.glyph_flags.begin() + first,
+                                      sample.glyph_flags.begin() + last);
+        }
+    };
+
+    append_copy(0, 0);
+    for (std::size_t target = 1; target + 1 < count; ++target) {
+        append_copy(1, target);
+    }
+    append_copy(3, count - 1);
+
+    ensures(result.codepoints.size() == glyph_count);
+    return result;
+}
+
+[[nodiscard]] auto shape_glyphs(std::string_view text_utf8, const Font &font,
+                                const ShapingOptions &options) -> ShapedGlyphs {
+    const auto span = TraceSpan {"shape_text"};
+
+    // tiling is opt-in through the automatic policy, explicit backends shape the
+    // whole text as the reference, and nominal shaping is already linear
+    if (options.backend_policy == ShapingBackendPolicy::automatic &&
+        options.quality != ShapingQuality::nominal &&
+        options.quality != ShapingQuality::monospace) {
+        if (const auto unit_size = find_repeated_unit(text_utf8); unit_size != 0) {
+            const auto unit_utf8 = text_utf8.substr(0, unit_size);
+            const auto count = text_utf8.size() / unit_size;
+
+            if (auto glyphs = shape_repeated(unit_utf8, count, font, options)) {
+                return std::move(*glyphs);
+            }
+        }
+    }
+
+    return shape_glyphs_direct(text_utf8, font, options);
+}
+
+// x-advance of each copy in font units, glyphs count for the copy of their cluster
+[[nodiscard]] auto copy_advances(const HbShapedText &text, std::size_t unit_size,
+                                 std::size_t count) -> std::vector<int64_t> {
+    auto result = std::vector<int64_t>(count);
+    const auto placements = get_placements(text.glyph_run());
+    const auto clusters = text.clusters();
+
+    for (std::size_t i = 0; i < clusters.size(); ++i) {
+        result.at(clusters[i] / unit_size) += placements[i].advance.x;
+    }
+    return result;
+}
+
+// options of texts shaped with a HbFont only
+[[nodiscard]] auto harfbuzz_options() -> ShapingOptions {
+    return ShapingOptions {.backend_policy = ShapingBackendPolicy::harfbuzz};
+}
+
+}  // namespace
+
+auto fill_to_width(std::string_view unit_utf8, const Font &font, double width,
+                   const ShapingOptions &options) -> HbShapedText {
+    const auto shape_copies = [&](std::size_t count) {
+        return HbShapedText {repeat_text(unit_utf8, count), font, options};
+    };
+
+    if (unit_utf8.empty() || !(width > 0)) {
+        return shape_copies(0);
+    }
+
+    // the first, an inner and the last copy, including kerning between copies
+    constexpr auto sample_count = std::size_t {3};
+    auto sample = shape_copies(sample_count);
+    const auto advances = copy_advances(sample, unit_utf8.size(), sample_count);
+    const auto scale = units_to_pixels(font.hb_font.hb_font(), font.bl_font.size()).x;
+
+    const auto first = advances[0];
+    const auto inner = advances[1];
+    const auto last = advances[2];
+    if (first <= 0 || inner <= 0 || last <= 0 || !(scale > 0)) {
+        return shape_copies(0);
+    }
+
+    // a copy on its own isn't kerned with a next one, like the last copy
+    const auto predicted = [&](std::size_t count) {
+        if (count < 2) {
+            return static_cast<double>(count == 0 ? 0 : last) * scale;
+        }
+        const auto units = first + narrow<int64_t>(count - 2) * inner + last;
+        return static_cast<double>(units) * scale;
+    };
+
+    auto count = std::size_t {0};
+    if (width >= predicted(2)) {
+        count = narrow<std::size_t>(
+                    std::floor((width / scale - static_cast<double>(first + last)) /
+                               static_cast<double>(inner))) +
+                2;
+    } else if (width >= predicted(1)) {
+        count = 1;
+    }
+    // rounding of the division
+    while (count > 0 && predicted(count) > width) {
+        --count;
+    }
+    while (predicted(count + 1) <= width) {
+        ++count;
+    }
+
+    auto result = count == sample_count ? std::move(sample) : shape_copies(count);
+    if (result.advance().x == predicted(count)) {
+        return result;
+    }
+
+    // contexts longer than a copy changed the edges, the neighbors are shaped
+    while (count > 0 && result.advance().x > width) {
+        result = shape_copies(--count);
+    }
+    while (true) {
+        auto next = shape_copies(count + 1);
+        if (next.advance().x > width) {
+            break;
+        }
+        result = std::move(next);
+        ++count;
+    }
+    return result;
+}
+
+//
+// Font Face
+//
+
+HbFontFace::HbFontFace() : face_ {create_immutable_face()} {
+    expects(face_ != nullptr);
+    ensures(hb_face_is_immutable(face_.get()));
+}
+
+HbFontFace::HbFontFace(std::span<const char> font_data, unsigned int font_index)
+    : face_ {create_immutable_face(create_hb_blob(font_data), font_index)} {
+    ensures(face_ != nullptr);
+    ensures(hb_face_is_immutable(face_.get()));
+}
+
+namespace {
+
+[[nodiscard]] auto to_char_span(std::span<const uint8_t> span) -> std::span<const char> {
+    return std::span<const char>(reinterpret_cast<const char *>(span.data()),
+                                 span.size());
+}
+
+}  // namespace
+
+HbFontFace::HbFontFace(std::span<const uint8_t> font_data, unsigned int font_index)
+    : HbFontFace {to_char_span(font_data), font_index} {}
+
+HbFontFace::HbFontFace(const BLArray<uint8_t> &font_data, unsigned int font_index)
+    : face_ {create_immutable_face(create_hb_blob(font_data), font_index)} {
+    ensures(face_ != nullptr);
+    ensures(hb_face_is_immutable(face_.get()));
+}
+
+auto HbFontFace::empty() const -> bool {
+    return hb_face_get_glyph_count(hb_face()) == 0;
+}
+
+auto HbFontFace::hb_face() const noexcept -> hb_face_t * {
+    expects(face_ != nullptr);
+    ensures(hb_face_is_immutable(face_.get()));
+
+    return face_.get();
+}
+
+//
+// Font
+//
+
+HbFont::HbFont() : font_ {create_immutable_font()} {
+    ensures(font_ != nullptr);
+    ensures(hb_font_is_immutable(font_.get()));
+}
+
+HbFont::HbFont(const HbFontFace &face) : font_ {create_immutable_font(face.hb_face())} {
+    ensures(font_ != nullptr);
+    ensures(hb_font_is_immutable(font_.get()));
+}
+
+auto HbFont::empty() const -> bool {
+    const auto *face = hb_font_get_face(hb_font());
+    expects(face != nullptr);
+
+    return hb_face_get_glyph_count(face) == 0;
+}
+
+auto HbFont::hb_font() const noexcept -> hb_font_t * {
+    expects(font_ != nullptr);
+    ensures(hb_font_is_immutable(font_.get()));
+
+    return font_.get();
+}
+
+//
+// Shaped Text
+//
+
+namespace {
+
+// start of the cluster at or before the glyph whose glyphs don't depend on the
+// text before it, zero at the start of the text
+[[nodiscard]] auto previous_concat_point(std::span<const uint32_t> clusters,
+                                         std::span<const uint8_t> glyph_flags,
+                                         std::size_t glyph) -> std::size_t {
+    expects(clusters.size() == glyph_flags.size());
+    expects(glyph <= clusters.size());
+
+    while (glyph > 0) {
+        --glyph;
+        const auto starts_cluster = glyph == 0 || clusters[glyph - 1] != clusters[glyph];
+        if (starts_cluster && (glyph_flags[glyph] & unsafe_glyph_flags) == 0) {
+            return glyph;
+        }
+    }
+    return 0;
+}
+
+// next such cluster start after the glyph, the glyph count at the end of the text
+[[nodiscard]] auto next_concat_point(std::span<const uint32_t> clusters,
+                                     std::span<const uint8_t> glyph_flags,
+                                     std::size_t glyph) -> std::size_t {
+    expects(clusters.size() == glyph_flags.size());
+    expects(glyph < clusters.size());
+
+    for (++glyph; glyph < clusters.size(); ++glyph) {
+        if (clusters[glyph - 1] != clusters[glyph] &&
+            (glyph_flags[glyph] & unsafe_glyph_flags) == 0) {
+            return glyph;
+        }
+    }
+    return clusters.size();
+}
+
+// right-to-left texts have their glyphs in visual order, so clusters descend
+[[nodiscard]] auto is_left_to_right(std::span<const uint32_t> clusters) -> bool {
+    return clusters.empty() || clusters.front() <= clusters.back();
+}
+
+template <typename T>
+[[nodiscard]] auto equal_ranges(const std::vector<T> &a, std::size_t a_begin,
+                                const std::vector<T> &b, std::size_t b_begin,
+                                std::size_t count) -> bool {
+    return std::equal(a.begin() + narrow<std::ptrdiff_t>(a_begin),
+                      a.begin() + narrow<std::ptrdiff_t>(a_begin + count),
+                      b.begin() + narrow<std::ptrdiff_t>(b_begin));
+}
+
+}  // namespace
+
+HbShapedText::HbShapedText(std::string_view text_utf8, const HbFont &font,
+                           float font_size)
+    : HbShapedText {
+          text_utf8.size(), font, font_size,
+          shape_glyphs(text_utf8, Font {.hb_font = font}, harfbuzz_options())} {}
+
+HbShapedText::HbShapedText(std::string_view text_utf8, const Font &font,
+                           const ShapingOptions &options)
+    : HbShapedText {text_utf8.size(), font.hb_font, font.bl_font.size(),
+                    shape_glyphs(text_utf8, font, options)} {}
+
+HbShapedText::HbShapedText(std::size_t text_size, const HbFont &font, float font_size,
+                           detail::ShapedGlyphs &&glyphs)
+    : codepoints_ {std::move(glyphs.codepoints)},
+      placements_ {std::move(glyphs.placements)},
+      clusters_ {std::move(glyphs.clusters)},
+      glyph_flags_ {std::move(glyphs.glyph_flags)},
+      bounding_box_ {
+          calculate_bounding_rect(codepoints_, placements_, font.hb_font(), font_size)},
+      scale_ {units_to_pixels(font.hb_font(), font_size)},
+      font_size_ {font_size},
+      text_size_ {text_size} {
+    ensures(codepoints_.size() == placements_.size());
+    ensures(codepoints_.size() == clusters_.size());
+    ensures(glyph_flags_.empty() || codepoints_.size() == glyph_flags_.size());
+
+    record_shaped_text(codepoints_.size());
+}
+
+auto HbShapedText::empty() const -> bool {
+    expects(codepoints_.size() == placements_.size());
+
+    return codepoints_.empty();
+}
+
+auto HbShapedText::operator==(const HbShapedText &other) const -> bool {
+    return text_size_ == other.text_size_ && codepoints_ == other.codepoints_ &&
+           placements_ == other.placements_ && clusters_ == other.clusters_ &&
+           bounding_box_ == other.bounding_box_;
+}
+
+auto HbShapedText::text_size() const noexcept -> std::size_t {
+    return text_size_;
+}
+
+auto HbShapedText::font_size() const noexcept -> float {
+    return font_size_;
+}
+
+auto HbShapedText::glyph_run() const noexcept -> BLGlyphRun {
+    expects(codepoints_.size() == placements_.size());
+
+    return make_glyph_run(codepoints_, placements_);
+}
+
+auto HbShapedText::styled_glyph_runs(std::span<const StyleRun> style_runs,
+                                     uint32_t default_style) const
+    -> std::vector<StyledGlyphRun> {
+    expects(std::ranges::all_of(
+        style_runs, [](const StyleRun &run) { return run.byte_begin <= run.byte_end; }));
+    const auto overlap = [](const StyleRun &a, const StyleRun &b) {
+        return a.byte_end > b.byte_begin;
+    };
+    expects(std::ranges::adjacent_find(style_runs, overlap) == style_runs.end());
+
+    const auto style_of = [&](uint32_t cluster) {
+        // last run starting at or before the cluster
+        const auto run = std::ranges::upper_bound(style_runs, std::size_t {cluster}, {},
+                                                  &StyleRun::byte_begin);
+        if (run == style_runs.begin() || cluster >= std::prev(run)->byte_end) {
+            return default_style;
+        }
+        return std::prev(run)->style;
+    };
+
+    const auto scale = scale_;
+    const auto codepoints = std::span {codepoints_};
+    const auto placements = std::span {placements_};
+
+    auto result = std::vector<StyledGlyphRun> {};
+    auto pen = BLPointI {};
+    auto first = std::size_t {0};
+
+    for (auto i = std::size_t {0}; i < codepoints_.size(); ++i) {
+        const auto style = style_of(clusters_[i]);
+
+        if (i == 0 || style != result.back().style) {
+            if (!result.empty()) {
+                result.back().glyph_run =
+                    make_glyph_run(codepoints.subspan(first, i - first),
+                                   placements.subspan(first, i - first));
+            }
+            result.push_back(StyledGlyphRun {
+                .style = style,
+                .origin = BLPoint {pen.x * scale.x, pen.y * scale.y},
+            });
+            first = i;
+        }
+
+        pen.x += placements_[i].advance.x;
+        pen.y += placements_[i].advance.y;
+    }
+    if (!result.empty()) {
+        result.back().glyph_run =
+            make_glyph_run(codepoints.subspan(first), placements.subspan(first));
+    }
+
+    return result;
+}
+
+auto HbShapedText::clusters() const noexcept -> std::span<const uint32_t> {
+    return clusters_;
+}
+
+auto HbShapedText::advance() const -> BLPoint {
+    auto advance = BLPointI {};
+    for (const auto &placement : placements_) {
+        advance.x += placement.advance.x;
+        advance.y += placement.advance.y;
+    }
+
+    return BLPoint {advance.x * scale_.x, advance.y * scale_.y};
+}
+
+auto HbShapedText::bounding_box() const noexcept -> BLBox {
+    return bounding_box_;
+}
+
+auto HbShapedText::bounding_rect() const noexcept -> BLRect {
+    const auto box = bounding_box_;
+    return BLRect {box.x0, box.y0, box.x1 - box.x0, box.y1 - box.y0};
+}
+
+auto HbShapedText::is_safe_to_break(std::size_t byte_offset) const -> bool {
+    expects(byte_offset <= text_size_);
+
+    if (byte_offset == 0 || byte_offset == text_size_) {
+        return true;
+    }
+
+    // the offset needs to start a cluster, whose first glyph is safe to break
+    const auto glyph = is_left_to_right(clusters_)
+                           ? std::ranges::lower_bound(clusters_, byte_offset)
+                           : std::ranges::lower_bound(clusters_, byte_offset,
+                                                      std::greater {});
+    if (glyph == clusters_.end() || *glyph != byte_offset) {
+        return false;
+    }
+    const auto index = narrow<std::size_t>(glyph - clusters_.begin());
+    return has_glyph_flags() &&
+           (glyph_flags_[index] & uint8_t {HB_GLYPH_FLAG_UNSAFE_TO_BREAK}) == 0;
+}
+
+auto HbShapedText::has_glyph_flags() const noexcept -> bool {
+    return glyph_flags_.size() == codepoints_.size();
+}
+
+auto HbShapedText::ensure_glyph_flags(std::string_view text_utf8, const HbFont &font)
+    -> void {
+    expects(text_utf8.size() == text_size_);
+
+    if (!has_glyph_flags()) {
+        glyph_flags_ = derive_glyph_flags(codepoints_, placements_, clusters_, text_utf8,
+                                          font.hb_font());
+    }
+}
+
+auto HbShapedText::memory_usage() const -> std::size_t {
+    return sizeof(HbShapedText) + heap_usage(codepoints_) + heap_usage(placements_) +
+           heap_usage(clusters_) + heap_usage(glyph_flags_);
+}
+
+/**
+ * @brief Follows the HarfBuzz algorithm for HB_GLYPH_FLAG_UNSAFE_TO_CONCAT.
+ *
+ * The window from the last cluster start of this text that is safe to
+ * concatenate to the first one of the other text is reshaped. It is spliced
+ * in if its first glyph is safe to concatenate, and so is its glyph at the
+ * window end when shaped with one more cluster. Otherwise the window grows,
+ * up to the whole text. With flags derived for Blend2D, an unsafe window start
+ * reshapes this text whole at once.
+ */
+auto HbShapedText::splice(std::string_view text_utf8, const HbShapedText &other,
+                          std::string_view other_utf8, const Font &font,
+                          const ShapingOptions &options) -> void {
+    expects(text_utf8.size() == text_size_);
+    expects(other_utf8.size() == other.text_size_);
+    expects(font_size_ == other.font_size_);
+    expects(has_glyph_flags() && other.has_glyph_flags());
+
+    if (other_utf8.empty()) {
+        return;
+    }
+    if (text_utf8.empty()) {
+        *this = other;
+        return;
+    }
+
+    const auto reshape_whole = [&] {
+        auto whole_utf8 = std::string {text_utf8};
+        whole_utf8.append(other_utf8);
+        *this = HbShapedText {whole_utf8, font, options};
+    };
+
+    // glyphs of right-to-left text are in visual order, they are reshaped whole
+    if (!is_left_to_right(clusters_) || !is_left_to_right(other.clusters_)) {
+        reshape_whole();
+        return;
+    }
+
+    // the automatic policy selects the backend by the whole text, a part
+    // shaped by the other backend is reshaped completely
+    const auto left_backend = resolve_backend(text_utf8, options);
+    const auto right_backend = resolve_backend(other_utf8, options);
+    const auto backend = left_backend == ShapingBackend::harfbuzz
+                             ? left_backend
+                             : right_backend;
+
+    auto window_options = options;
+    if (options.backend_policy == ShapingBackendPolicy::automatic) {
+        window_options.backend_policy = backend == ShapingBackend::harfbuzz
+                                            ? ShapingBackendPolicy::harfbuzz
+                                            : ShapingBackendPolicy::blend2d;
+    }
+
+    const auto right_count = other.clusters_.size();
+    const auto right_byte = [&](std::size_t glyph) {
+        return glyph == right_count ? other_utf8.size()
+                                    : std::size_t {other.clusters_[glyph]};
+    };
+
+    // glyph index of the window start in this text and of its end in the other
+    auto first = left_backend != backend ? std::size_t {0}
+                                         : previous_concat_point(clusters_, glyph_flags_,
+                                                                 clusters_.size());
+    auto last = right_backend != backend || right_count == 0
+                    ? right_count
+                    : next_concat_point(other.clusters_, other.glyph_flags_, 0);
+    auto window_utf8 = std::string {};
+
+    while (true) {
+        const auto byte_begin =
+            first == 0 ? std::size_t {0} : std::size_t {clusters_[first]};
+        // one more cluster shows if the end of the window is safe
+        const auto lookahead =
+            last == right_count
+                ? last
+                : next_concat_point(other.clusters_, other.glyph_flags_, last);
+
+        window_utf8.assign(text_utf8.substr(byte_begin));
+        window_utf8.append(other_utf8.substr(0, right_byte(lookahead)));
+        auto window = shape_glyphs(window_utf8, font, window_options);
+        const auto derived =
+            derive_missing_glyph_flags(window, window_utf8, font.hb_font.hb_font());
+        if (!is_left_to_right(window.clusters)) {
+            reshape_whole();
+            return;
+        }
+
+        const auto seam = text_size_ - byte_begin + right_byte(last);
+        auto split = narrow<std::size_t>(std::ranges::lower_bound(window.clusters, seam) -
+                                         window.clusters.begin());
+
+        const auto start_safe = first == 0 || window.codepoints.empty() ||
+                                (window.glyph_flags.front() & unsafe_glyph_flags) == 0;
+        auto end_safe =
+            last == right_count ||
+            (split < window.clusters.size() && window.clusters[split] == seam &&
+             (window.glyph_flags[split] & unsafe_glyph_flags) == 0);
+        if (!end_safe && lookahead == right_count) {
+            // the window already reaches the end of the text
+            end_safe = true;
+            last = right_count;
+            split = window.codepoints.size();
+        }
+
+        if (!start_safe) {
+            // derived flags are conservative, walking back one cluster at a time
+            // would reshape a window for each of them
+            first = derived ? 0 : previous_concat_point(clusters_, glyph_flags_, first);
+        }
+        if (!end_safe) {
+            last = lookahead;
+        }
+        if (!start_safe || !end_safe) {
+            continue;
+        }
+
+        // the boxes stay valid if the glyphs next to the seam didn't change
+        const auto left_count = clusters_.size() - first;
+        const auto unchanged =
+            split == left_count + last &&
+            equal_ranges(window.codepoints, 0, codepoints_, first, left_count) &&
+            equal_ranges(window.placements, 0, placements_, first, left_count) &&
+            equal_ranges(window.codepoints, left_count, other.codepoints_, 0, last) &&
+            equal_ranges(window.placements, left_count, other.placements_, 0, last);
+        const auto offset = advance();
+
+        const auto keep = narrow<std::ptrdiff_t>(first);
+        const auto take = narrow<std::ptrdiff_t>(split);
+        const auto skip = narrow<std::ptrdiff_t>(last);
+        const auto window_offset = narrow<uint32_t>(byte_begin);
+        const auto right_offset = narrow<uint32_t>(text_size_);
+
+        codepoints_.erase(codepoints_.begin() + keep, codepoints_.end());
+        placements_.erase(placements_.begin() + keep, placements_.end());
+        clusters_.erase(clusters_.begin() + keep, clusters_.end());
+        glyph_flags_.erase(glyph_flags_.begin() + keep, glyph_flags_.end());
+
+        codepoints_.insert(codepoints_.end(), window.codepoints.begin(),
+                           window.codepoints.begin() + take);
+        placements_.insert(placements_.end(), window.placements.begin(),
+                           window.placements.begin() + take);
+        std::transform(window.clusters.begin(), window.clusters.begin() + take,
+                       std::back_inserter(clusters_),
+                       [=](uint32_t cluster) { return cluster + window_offset; });
+        glyph_flags_.insert(glyph_flags_.end(), window.glyph_flags.begin(),
+                            window.glyph_flags.begin() + take);
+
+        codepoints_.insert(codepoints_.end(), other.codepoints_.begin() + skip,
+                           other.codepoints_.end());
+        placements_.insert(placements_.end(), other.placements_.begin() + skip,
+                           other.placements_.end());
+        std::transform(other.clusters_.begin() + skip, other.clusters_.end(),
+                       std::back_inserter(clusters_),
+                       [=](uint32_t cluster) { return cluster + right_offset; });
+        glyph_flags_.insert(glyph_flags_.end(), other.glyph_flags_.begin() + skip,
+                            other.glyph_flags_.end());
+
+        text_size_ += other.text_size_;
+
+        if (!unchanged) {
+            bounding_box_ = calculate_bounding_rect(codepoints_, placements_,
+                                                    font.hb_font.hb_font(), font_size_);
+        } else if (other.bounding_box_ != BLBox {}) {
+            bounding_box_ = merge_boxes(bounding_box_, other.bounding_box_ + offset);
+        }
+        return;
+    }
+}
+
+auto HbShapedText::slice_glyphs(std::size_t byte_begin, std::size_t byte_end,
+                                const HbFont &font) const -> HbShapedText {
+    expects(has_glyph_flags());
+    expects(is_safe_to_break(byte_begin));
+    expects(is_safe_to_break(byte_end));
+
+    const auto first = narrow<std::size_t>(
+        std::ranges::lower_bound(clusters_, byte_begin) - clusters_.begin());
+    const auto last = narrow<std::size_t>(
+        std::ranges::lower_bound(clusters_, byte_end) - clusters_.begin());
+    const auto cluster_offset = narrow<uint32_t>(byte_begin);
+
+    auto glyphs = detail::ShapedGlyphs {
+        .codepoints = {codepoints_.begin() + first, codepoints_.begin() + last},
+        .placements = {placements_.begin() + first, placements_.begin() + last},
+        .clusters = {},
+        .glyph_flags = {glyph_flags_.begin() + first, glyph_flags_.begin() + last},
+    };
+    glyphs.clusters.reserve(last - first);
+    std::transform(clusters_.begin() + first, clusters_.begin() + last,
+                   std::back_inserter(glyphs.clusters),
+                   [=](uint32_t cluster) { return cluster - cluster_offset; });
+
+    return HbShapedText {byte_end - byte_begin, font, font_size_, std::move(glyphs)};
+}
+
+auto calculate_bounding_box(const BLGlyphRun &glyph_run, const HbFont &font,
+                            float font_size) -> BLBox {
+    return calculate_bounding_rect(get_codepoints(glyph_run), get_placements(glyph_run),
+                                   font.hb_font(), font_size);
+}
+
+//
+// Editable Shaped Text
+//
+
+EditableShapedText::EditableShapedText(std::string_view text_utf8, const Font &font,
+                                       const ShapingOptions &options)
+    : EditableShapedText {text_utf8, font, options,
+                          HbShapedText {text_utf8, font, options}} {}
+
+EditableShapedText::EditableShapedText(std::string_view text_utf8, const Font &font,
+                                       const ShapingOptions &options,
+                                       HbShapedText &&shaped)
+    : text_utf8_ {text_utf8},
+      font_ {font},
+      options_ {options},
+      shaped_ {std::move(shaped)} {
+    shaped_.ensure_glyph_flags(text_utf8_, font_.hb_font);
+}
+
+auto EditableShapedText::text_utf8() const noexcept -> std::string_view {
+    return text_utf8_;
+}
+
+auto EditableShapedText::font() const noexcept -> const Font & {
+    return font_;
+}
+
+auto EditableShapedText::options() const noexcept -> const ShapingOptions & {
+    return options_;
+}
+
+auto EditableShapedText::shaped() const noexcept -> const HbShapedText & {
+    return shaped_;
+}
+
+auto EditableShapedText::append(const EditableShapedText &other) -> void {
+    expects(font_.hb_font == other.font_.hb_font);
+    expects(font_.bl_font.size() == other.font_.bl_font.size());
+    expects(options_ == other.options_);
+
+    shaped_.splice(text_utf8_, other.shaped_, other.text_utf8_, font_, options_);
+    text_utf8_.append(other.text_utf8_);
+}
+
+auto EditableShapedText::append(std::string_view text_utf8) -> void {
+    if (text_utf8.empty()) {
+        return;
+    }
+    auto shaped = HbShapedText {text_utf8, font_, options_};
+    shaped.ensure_glyph_flags(text_utf8, font_.hb_font);
+
+    shaped_.splice(text_utf8_, shaped, text_utf8, font_, options_);
+    text_utf8_.append(text_utf8);
+}
+
+auto EditableShapedText::slice(std::size_t byte_begin, std::size_t byte_end) const
+    -> EditableShapedText {
+    expects(byte_begin <= byte_end);
+    expects(byte_end <= text_utf8_.size());
+
+    const auto text_utf8 =
+        std::string_view {text_utf8_}.substr(byte_begin, byte_end - byte_begin);
+
+    // the automatic policy can select another backend for the range alone, and
+    // glyphs of right-to-left text are in visual order
+    if (!is_left_to_right(shaped_.clusters()) || !shaped_.is_safe_to_break(byte_begin) ||
+        !shaped_.is_safe_to_break(byte_end) ||
+        resolve_backend(text_utf8, options_) != resolve_backend(text_utf8_, options_)) {
+        return EditableShapedText {text_utf8, font_, options_};
+    }
+    return EditableShapedText {text_utf8, font_, options_,
+                               shaped_.slice_glyphs(byte_begin, byte_end, font_.hb_font)};
+}
+
+auto EditableShapedText::memory_usage() const -> std::size_t {
+    return sizeof(EditableShapedText) - sizeof(HbShapedText) + heap_usage(text_utf8_) +
+           heap_usage(options_.features) + shaped_.memory_usage();
+}
+
+auto concat(const EditableShapedText &first, const EditableShapedText &second)
+    -> EditableShapedText {
+    auto result = first;
+    result.append(second);
+    return result;
+}
+
+//
+// Text Diff
+//
+
+namespace {
+
+auto append_glyph_index(std::vector<GlyphRange> &ranges, std::size_t index) -> void {
+    if (!ranges.empty() && ranges.back().end == index) {
+        ++ranges.back().end;
+    } else {
+        ranges.push_back(GlyphRange {.begin = index, .end = index + 1});
+    }
+}
+
+}  // namespace
+
+auto ShapedTextDiff::empty() const -> bool {
+    return removed.empty() && added.empty();
+}
+
+auto diff(const HbShapedText &previous, const HbShapedText &next, const HbFont &font)
+    -> ShapedTextDiff {
+    auto result = ShapedTextDiff {};
+
+    if (previous.font_size_ != next.font_size_) {
+        if (!previous.codepoints_.empty()) {
+            result.removed.push_back(GlyphRange {0, previous.codepoints_.size()});
+        }
+        if (!next.codepoints_.empty()) {
+            result.added.push_back(GlyphRange {0, next.codepoints_.size()});
+        }
+        result.dirty_box = merge_boxes(previous.bounding_box_, next.bounding_box_);
+        return result;
+    }
+
+    auto *hb_font = font.hb_font();
+    auto dirty_box = BLBox {};
+
+    // walks both glyph sequences by pen position, in font units
+    struct Cursor {
+        const HbShapedText &text;
+        std::vector<GlyphRange> &changed;
+        std::size_t index {};
+        BLPointI pen {};
+
+        [[nodiscard]] auto done() const -> bool {
+            return index >= text.codepoints_.size();
+        }
+
+        auto advance() -> void {
+            pen.x += text.placements_[index].advance.x;
+            pen.y += text.placements_[index].advance.y;
+            ++index;
+        }
+    };
+
+    auto before = Cursor {.text = previous, .changed = result.removed};
+    auto after = Cursor {.text = next, .changed = result.added};
+
+    const auto mark_changed = [&](Cursor &cursor) {
+        const auto &pos = cursor.text.placements_[cursor.index];
+        if (const auto box = get_glyph_box(hb_font, cursor.text.codepoints_[cursor.index],
+                                           BLPoint {cursor.pen}, pos)) {
+            dirty_box = merge_boxes(dirty_box, *box);
+        }
+        append_glyph_index(cursor.changed, cursor.index);
+        cursor.advance();
+    };
+
+    while (!before.done() && !after.done()) {
+        if (before.pen == after.pen &&
+            previous.codepoints_[before.index] == next.codepoints_[after.index] &&
+            previous.placements_[before.index] == next.placements_[after.index]) {
+            before.advance();
+            after.advance();
+            continue;
+        }
+
+        // the glyph further behind can no longer match, on a tie both changed
+        const auto before_x = before.pen.x;
+        const auto after_x = after.pen.x;
+        if (before_x <= after_x) {
+            mark_changed(before);
+        }
+        if (after_x <= before_x) {
+            mark_changed(after);
+        }
+    }
+    while (!before.done()) {
+        mark_changed(before);
+    }
+    while (!after.done()) {
+        mark_changed(after);
+    }
+
+    if (dirty_box != BLBox {}) {
+        const auto scale = previous.scale_;
+        result.dirty_box = BLBox {dirty_box.x0 * scale.x, dirty_box.y0 * scale.y,
+                                  dirty_box.x1 * scale.x, dirty_box.y1 * scale.y};
+    }
+    return result;
+}
+
+//
+// Shaping Backends
+//
+
+auto select_shaping_backend(std::string_view text_utf8, const ShapingOptions &options)
+    -> ShapingBackend {
+    if (!options.features.empty() || !is_simple_text(text_utf8)) {
+        return ShapingBackend::harfbuzz;
+    }
+    return ShapingBackend::blend2d;
+}
+
+auto ShapingParity::equal() const -> bool {
+    return harfbuzz == blend2d;
+}
+
+auto check_shaping_parity(std::string_view text_utf8, const Font &font,
+                          const ShapingOptions &options) -> ShapingParity {
+    auto harfbuzz_options = options;
+    harfbuzz_options.backend_policy = ShapingBackendPolicy::harfbuzz;
+    harfbuzz_options.quality = ShapingQuality::full;
+
+    auto blend2d_options = options;
+    blend2d_options.backend_policy = ShapingBackendPolicy::blend2d;
+    blend2d_options.quality = ShapingQuality::full;
+
+    return ShapingParity {
+        .harfbuzz = HbShapedText {text_utf8, font, harfbuzz_options},
+        .blend2d = HbShapedText {text_utf8, font, blend2d_options},
+    };
+}
+
+//
+// Numeric Text
+//
+
+namespace {
+
+constexpr auto numeric_characters = std::string_view {"0123456789+-.,:% "};
+
+// numbers compared with shaping, alone and with each suffix
+constexpr auto numeric_samples =
+    std::array {std::string_view {"0123456789"}, std::string_view {"-1,234.50"},
+                std::string_view {"+98.76%"}, std::string_view {"10:45:30"},
+                std::string_view {"1111 7777"}, std::string_view {"0.0"}};
+
+[[nodiscard]] auto add_placements(const BLGlyphPlacement &a, const BLGlyphPlacement &b)
+    -> BLGlyphPlacement {
+    return BLGlyphPlacement {
+        .placement =
+            BLPointI {a.placement.x + b.placement.x, a.placement.y + b.placement.y},
+        .advance = BLPointI {a.advance.x + b.advance.x, a.advance.y + b.advance.y},
+    };
+}
+
+[[nodiscard]] auto subtract_placements(const BLGlyphPlacement &a,
+                                       const BLGlyphPlacement &b) -> BLGlyphPlacement {
+    return BLGlyphPlacement {
+        .placement =
+            BLPointI {a.placement.x - b.placement.x, a.placement.y - b.placement.y},
+        .advance = BLPointI {a.advance.x - b.advance.x, a.advance.y - b.advance.y},
+    };
+}
+
+/**
+ * @brief Returns the change of the left glyph when shaped together with the right.
+ *
+ * Returns nullopt if the pair substitutes glyphs or moves the right glyphs, as
+ * then the pair cannot be assembled from its parts.
+ */
+[[nodiscard]] auto get_pair_delta(const HbShapedText &pair, uint32_t left_codepoint,
+                                  const BLGlyphPlacement &left_placement,
+                                  std::span<const uint32_t> right_codepoints,
+                                  std::span<const BLGlyphPlacement> right_placements)
+    -> std::optional<BLGlyphPlacement> {
+    const auto glyph_run = pair.glyph_run();
+    const auto codepoints = get_codepoints(glyph_run);
+    const auto placements = get_placements(glyph_run);
+
+    if (codepoints.size() != right_codepoints.size() + 1 ||
+        codepoints.front() != left_codepoint ||
+        !std::ranges::equal(codepoints.subspan(1), right_codepoints) ||
+        !std::ranges::equal(placements.subspan(1), right_placements)) {
+        return std::nullopt;
+    }
+
+    return subtract_placements(placements.front(), left_placement);
+}
+
+[[nodiscard]] auto numeric_shaping_options(bool tabular_figures) -> ShapingOptions {
+    auto options = ShapingOptions {};
+    if (tabular_figures) {
+        options.features.push_back(FontFeature {.tag = BL_MAKE_TAG('t', 'n', 'u', 'm')});
+    }
+    return options;
+}
+
+}  // namespace
+
+NumericTextShaper::NumericTextShaper(const Font &font,
+                                     std::span<const std::string_view> suffixes,
+                                     bool tabular_figures)
+    : font_ {font}, options_ {numeric_shaping_options(tabular_figures)} {
+    for (const auto character : numeric_characters) {
+        const auto text_utf8 = std::string_view {&character, 1};
+        auto shaped = HbShapedText {text_utf8, font_, options_};
+        shaped.ensure_glyph_flags(text_utf8, font_.hb_font);
+        if (shaped.codepoints_.size() != 1) {
+            continue;
+        }
+
+        codepoints_.push_back(shaped.codepoints_.front());
+        placements_.push_back(shaped.placements_.front());
+        glyph_flags_.push_back(shaped.glyph_flags_.front());
+        char_index_.at(static_cast<uint8_t>(character)) =
+            narrow<uint8_t>(codepoints_.size());
+    }
+
+    const auto count = codepoints_.size();
+    pairs_.resize(count * count);
+
+    for (const auto left : numeric_characters) {
+        for (const auto right : numeric_characters) {
+            const auto left_index = char_index_.at(static_cast<uint8_t>(left));
+            const auto right_index = char_index_.at(static_cast<uint8_t>(right));
+            if (left_index == 0 || right_index == 0) {
+                continue;
+            }
+
+            const auto text = std::array {left, right};
+            const auto text_view = std::string_view {text.data(), text.size()};
+            const auto shaped = HbShapedText {text_view, font_, options_};
+            const auto delta = get_pair_delta(
+                shaped, codepoints_[left_index - 1], placements_[left_index - 1],
+                std::span {&codepoints_[right_index - 1], 1},
+                std::span {&placements_[right_index - 1], 1});
+
+            if (delta) {
+                pairs_[(left_index - 1) * count + (right_index - 1)] = PairAdjustment {
+                    .delta = *delta,
+                    .pre_shaped = true,
+                };
+            }
+        }
+    }
+
+    for (const auto suffix_utf8 : suffixes) {
+        auto suffix = Suffix {
+            .text_utf8 = std::string {suffix_utf8},
+            .shaped = HbShapedText {suffix_utf8, font_, options_},
+            .pairs = std::vector<PairAdjustment>(count),
+        };
+        suffix.shaped.ensure_glyph_flags(suffix_utf8, font_.hb_font);
+
+        for (const auto left : numeric_characters) {
+            const auto left_index = char_index_.at(static_cast<uint8_t>(left));
+            if (left_index == 0) {
+                continue;
+            }
+
+            auto text = std::string {left};
+            text.append(suffix_utf8);
+            const auto delta = get_pair_delta(
+                HbShapedText {text, font_, options_}, codepoints_[left_index - 1],
+                placements_[left_index - 1], suffix.shaped.codepoints_,
+                suffix.shaped.placements_);
+
+            if (delta) {
+                suffix.pairs[left_index - 1] = PairAdjustment {
+                    .delta = *delta,
+                    .pre_shaped = true,
+                };
+            }
+        }
+
+        suffixes_.push_back(std::move(suffix));
+    }
+
+    // pairs don't capture contextual positioning over more glyphs
+    verified_ = true;
+    const auto matches_shaping = [&](std::string_view text_utf8) {
+        return !is_pre_shaped(text_utf8) ||
+               shape(text_utf8) == HbShapedText {text_utf8, font_, options_};
+    };
+    for (const auto number : numeric_samples) {
+        verified_ = verified_ && matches_shaping(number);
+
+        for (const auto suffix_utf8 : suffixes) {
+            verified_ = verified_ && matches_shaping(std::string {number} +
+                                                     std::string {suffix_utf8});
+        }
+    }
+}
+
+auto NumericTextShaper::options() const noexcept -> const ShapingOptions & {
+    return options_;
+}
+
+auto NumericTextShaper::find_suffix(std::string_view text_utf8) const -> const Suffix * {
+    const Suffix *result = nullptr;
+
+    for (const auto &suffix : suffixes_) {
+        const auto &suffix_utf8 = suffix.text_utf8;
+
+        if (suffix_utf8.empty() || !text_utf8.ends_with(suffix_utf8)) {
+            continue;
+        }
+        if (result == nullptr || suffix_utf8.size() > result->text_utf8.size()) {
+            result = &suffix;
+        }
+    }
+
+    return result;
+}
+
+auto NumericTextShaper::is_pre_shaped(std::string_view text_utf8) const -> bool {
+    if (!verified_) {
+        return false;
+    }
+
+    const auto *suffix = find_suffix(text_utf8);
+    const auto suffix_length = suffix == nullptr ? 0 : suffix->text_utf8.size();
+    const auto number = text_utf8.substr(0, text_utf8.size() - suffix_length);
+
+    const auto count = codepoints_.size();
+    auto previous = std::size_t {0};
+
+    for (const auto character : number) {
+        const auto index = static_cast<uint8_t>(character) < char_index_.size()
+                               ? char_index_[static_cast<uint8_t>(character)]
+                               : uint8_t {0};
+        if (index == 0 ||
+            (previous != 0 && !pairs_[(previous - 1) * count + (index - 1)].pre_shaped)) {
+            return false;
+        }
+        previous = index;
+    }
+
+    return suffix == nullptr || previous == 0 || suffix->pairs[previous - 1].pre_shaped;
+}
+
+auto NumericTextShaper::shape(std::string_view text_utf8) const -> HbShapedText {
+    if (!is_pre_shaped(text_utf8)) {
+        return HbShapedText {text_utf8, font_, options_};
+    }
+
+    const auto *suffix = find_suffix(text_utf8);
+    const auto suffix_length = suffix == nullptr ? 0 : suffix->text_utf8.size();
+    const auto number = text_utf8.substr(0, text_utf8.size() - suffix_length);
+    const auto glyph_count =
+        number.size() + (suffix == nullptr ? 0 : suffix->shaped.codepoints_.size());
+
+    auto glyphs = detail::ShapedGlyphs {};
+    glyphs.codepoints.reserve(glyph_count);
+    glyphs.placements.reserve(glyph_count);
+    glyphs.clusters.reserve(glyph_count);
+    glyphs.glyph_flags.reserve(glyph_count);
+
+    const auto count = codepoints_.size();
+    auto previous = std::size_t {0};
+
+    // kerned pairs are unsafe to break, like HarfBuzz marks them
+    const auto apply_pair = [&](const PairAdjustment &pair) -> uint8_t {
+        glyphs.placements.back() = add_placements(glyphs.placements.back(), pair.delta);
+        return pair.delta == BLGlyphPlacement {} ? uint8_t {0} : unsafe_glyph_flags;
+    };
+
+    for (std::size_t i = 0; i < number.size(); ++i) {
+        const auto index = std::size_t {char_index_[static_cast<uint8_t>(number[i])]};
+        const auto flags = previous == 0
+                               ? glyph_flags_[index - 1]
+                               : apply_pair(pairs_[(previous - 1) * count + (index - 1)]);
+
+        glyphs.codepoints.push_back(codepoints_[index - 1]);
+        glyphs.placements.push_back(placements_[index - 1]);
+        glyphs.clusters.push_back(narrow<uint32_t>(i));
+        glyphs.glyph_flags.push_back(flags);
+        previous = index;
+    }
+
+    if (suffix != nullptr) {
+        const auto &shaped = suffix->shaped;
+        const auto first_flags = previous == 0 ? uint8_t {0}
+                                               : apply_pair(suffix->pairs[previous - 1]);
+
+        glyphs.codepoints.insert(glyphs.codepoints.end(), shaped.codepoints_.begin(),
+                                 shaped.codepoints_.end());
+        glyphs.placements.insert(glyphs.placements.end(), shaped.placements_.begin(),
+                                 shaped.placements_.end());
+        std::ranges::transform(
+            shaped.clusters_, std::back_inserter(glyphs.clusters),
+            [&](uint32_t cluster) { return narrow<uint32_t>(cluster + number.size()); });
+        glyphs.glyph_flags.insert(glyphs.glyph_flags.end(), shaped.glyph_flags_.begin(),
+                                  shaped.glyph_flags_.end());
+
+        if (!shaped.empty() && previous != 0) {
+            glyphs.glyph_flags[number.size()] |= first_flags;
+        }
+    } else if (previous != 0) {
+        glyphs.glyph_flags.back() |= glyph_flags_[previous - 1];
+    }
+
+    return HbShapedText {text_utf8.size(), font_.hb_font, font_.bl_font.size(),
+                         std::move(glyphs)};
+}
+
+auto NumericTextShaper::format(double value, int precision, std::string_view suffix) const
+    -> HbShapedText {
+    expects(precision >= 0);
+
+    auto buffer = std::array<char, 128> {};
+    const auto [end, error] =
+        std::to_chars(buffer.data(), buffer.data() + buffer.size(), value,
+                      std::chars_format::fixed, precision);
+    const auto length = narrow<std::size_t>(end - buffer.data());
+
+    if (error == std::errc {} && length + suffix.size() <= buffer.size()) {
+        std::ranges::copy(suffix, end);
+        return shape(std::string_view {buffer.data(), length + suffix.size()});
+    }
+
+    // values this long are not live readouts
+    auto stream = std::ostringstream {};
+    stream << std::fixed << std::setprecision(precision) << value << suffix;
+    return shape(stream.str());
+}
+
+//
+// Attributed Text
+//
+
+AttributedText::AttributedText(std::string_view text_utf8,
+                               std::span<const AttributedRun> runs)
+    : text_utf8_ {text_utf8} {
+    expects(std::ranges::all_of(runs, [&](const AttributedRun &run) {
+        return run.byte_begin <= run.byte_end && run.byte_end <= text_utf8.size();
+    }));
+    const auto overlap = [](const AttributedRun &a, const AttributedRun &b) {
+        return a.byte_end > b.byte_begin;
+    };
+    expects(std::ranges::adjacent_find(runs, overlap) == runs.end());
+
+    // one buffer and one glyph storage for all runs
+    const auto buffer = HbBufferPointer {hb_buffer_create()};
+    expects(buffer != nullptr);
+
+    // reused by all runs, so runs with features don't allocate each
+    auto hb_features = std::vector<hb_feature_t> {};
+
+    runs_.reserve(runs.size());
+    codepoints_.reserve(text_utf8.size());
+    placements_.reserve(text_utf8.size());
+    clusters_.reserve(text_utf8.size());
+
+    for (const auto &run : runs) {
+        auto *hb_font = run.font.hb_font.hb_font();
+        to_hb_features(run.features, hb_features);
+        shape_text_item(buffer.get(), text_utf8, run.byte_begin,
+                        run.byte_end - run.byte_begin, hb_font, hb_features);
+
+        const auto glyph_infos = get_glyph_infos(buffer.get());
+        const auto glyph_positions = get_hb_glyph_positions(buffer.get());
+        const auto glyph_begin = codepoints_.size();
+
+        auto advance = BLPointI {};
+        expects(glyph_infos.size() == glyph_positions.size());
+
+        {
+            const auto timer = StageTimer {ShapingStage::glyph_extraction};
+            for (std::size_t i = 0; i < glyph_infos.size(); ++i) {
+                const auto &info = glyph_infos[i];
+                const auto &position = glyph_positions[i];
+
+                codepoints_.push_back(info.codepoint);
+                placements_.push_back(BLGlyphPlacement {
+                    .placement = BLPointI {position.x_offset, position.y_offset},
+                    .advance = BLPointI {position.x_advance, position.y_advance},
+                });
+                clusters_.push_back(info.cluster);
+
+                advance.x += position.x_advance;
+                advance.y += position.y_advance;
+            }
+        }
+
+        const auto font_size = run.font.bl_font.size();
+        const auto box = calculate_bounding_rect(
+            std::span {codepoints_}.subspan(glyph_begin),
+            std::span {placements_}.subspan(glyph_begin), hb_font, font_size);
+        if (box != BLBox {}) {
+            bounding_box_ = merge_boxes(bounding_box_, box + advance_);
+        }
+
+        runs_.push_back(Run {
+            .font = run.font,
+            .glyph_begin = glyph_begin,
+            .glyph_end = codepoints_.size(),
+            .origin = advance_,
+        });
+
+        const auto scale = units_to_pixels(hb_font, font_size);
+        advance_.x += advance.x * scale.x;
+        advance_.y += advance.y * scale.y;
+    }
+
+    record_shaped_text(codepoints_.size());
+}
+
+auto AttributedText::empty() const -> bool {
+    return codepoints_.empty();
+}
+
+auto AttributedText::text_utf8() const noexcept -> std::string_view {
+    return text_utf8_;
+}
+
+auto AttributedText::run_count() const noexcept -> std::size_t {
+    return runs_.size();
+}
+
+auto AttributedText::font(std::size_t run) const -> const Font & {
+    expects(run < runs_.size());
+    return runs_[run].font;
+}
+
+auto AttributedText::origin(std::size_t run) const -> BLPoint {
+    expects(run < runs_.size());
+    return runs_[run].origin;
+}
+
+auto AttributedText::glyph_run(std::size_t run) const -> BLGlyphRun {
+    expects(run < runs_.size());
+
+    const auto &item = runs_[run];
+    const auto count = item.glyph_end - item.glyph_begin;
+    return make_glyph_run(std::span {codepoints_}.subspan(item.glyph_begin, count),
+                          std::span {placements_}.subspan(item.glyph_begin, count));
+}
+
+auto AttributedText::clusters() const noexcept -> std::span<const uint32_t> {
+    return clusters_;
+}
+
+auto AttributedText::advance() const noexcept -> BLPoint {
+    return advance_;
+}
+
+auto AttributedText::bounding_box() const noexcept -> BLBox {
+    return bounding_box_;
+}
+
+auto AttributedText::bounding_rect() const noexcept -> BLRect {
+    const auto box = bounding_box_;
+    return BLRect {box.x0, box.y0, box.x1 - box.x0, box.y1 - box.y0};
+}
+
+//
+// Text Templates
+//
+
+ShapedTextTemplate::ShapedTextTemplate(std::string_view pattern_utf8, const Font &font,
+                                       const ShapingOptions &options)
+    : font_ {font}, options_ {options} {
+    auto segment = std::string {};
+    auto position = std::size_t {0};
+
+    while (position < pattern_utf8.size()) {
+        const auto character = pattern_utf8[position];
+        const auto is_brace = character == '{' || character == '}';
+        const auto is_repeated = position + 1 < pattern_utf8.size() &&
+                                 pattern_utf8[position + 1] == character;
+
+        // escaped braces
+        if (is_brace && is_repeated) {
+            segment.push_back(character);
+            position += 2;
+            continue;
+        }
+        if (character == '}') {
+            throw std::runtime_error("Unmatched closing brace in text template");
+        }
+        if (character != '{') {
+            segment.push_back(character);
+            ++position;
+            continue;
+        }
+
+        const auto end = pattern_utf8.find('}', position);
+        if (end == std::string_view::npos) {
+            throw std::runtime_error("Unmatched opening brace in text template");
+        }
+        const auto digits = pattern_utf8.substr(position + 1, end - position - 1);
+        auto index = std::size_t {0};
+        const auto [last, error] =
+            std::from_chars(digits.data(), digits.data() + digits.size(), index);
+        if (digits.empty() || error != std::errc {} ||
+            last != digits.data() + digits.size()) {
+            throw std::runtime_error("Invalid field index in text template");
+        }
+
+        add_segment(segment);
+        field_indices_.push_back(index);
+        field_count_ = std::max(field_count_, index + 1);
+
+        segment.clear();
+        position = end + 1;
+    }
+
+    add_segment(segment);
+    ensures(segments_.size() == field_indices_.size() + 1);
+}
+
+auto ShapedTextTemplate::add_segment(std::string_view text_utf8) -> void {
+    auto shaped = HbShapedText {text_utf8, font_, options_};
+    shaped.ensure_glyph_flags(text_utf8, font_.hb_font);
+
+    segments_.push_back(Segment {std::string {text_utf8}, std::move(shaped)});
+}
+
+auto ShapedTextTemplate::field_count() const noexcept -> std::size_t {
+    return field_count_;
+}
+
+auto ShapedTextTemplate::instantiate(std::span<const std::string_view> fields) const
+    -> HbShapedText {
+    expects(fields.size() >= field_count_);
+    expects(!segments_.empty());
+
+    auto result = segments_.front().shaped;
+    // text of the result so far, to reshape around unsafe splice points
+    auto text_utf8 = segments_.front().text_utf8;
+
+    const auto splice = [&](const HbShapedText &part, std::string_view part_utf8) {
+        result.splice(text_utf8, part, part_utf8, font_, options_);
+        text_utf8.append(part_utf8);
+    };
+
+    for (std::size_t i = 0; i < field_indices_.size(); ++i) {
+        const auto field_utf8 = fields[field_indices_[i]];
+        const auto &segment = segments_[i + 1];
+
+        auto field = HbShapedText {field_utf8, font_, options_};
+        field.ensure_glyph_flags(field_utf8, font_.hb_font);
+
+        splice(field, field_utf8);
+        splice(segment.shaped, segment.text_utf8);
+    }
+
+    return result;
+}
+
+//
+// Shaped Text Cache
+//
+
+ShapedTextCache::ShapedTextCache(const Font &font, std::size_t capacity,
+                                 const ShapingOptions &options)
+    : font_ {font}, options_ {options}, capacity_ {capacity} {
+    expects(capacity > 0);
+    index_.reserve(capacity);
+}
+
+auto ShapedTextCache::get(std::string_view text_utf8) -> const HbShapedText & {
+    expects(capacity_ > 0);
+    const auto span = TraceSpan {"ShapedTextCache::get"};
+
+    if (const auto entry = index_.find(text_utf8); entry != index_.end()) {
+        ++hits_;
+        entries_.splice(entries_.begin(), entries_, entry->second);
+        return entry->second->shaped;
+    }
+    ++misses_;
+
+    if (entries_.size() >= capacity_) {
+        index_.erase(entries_.back().text_utf8);
+        entries_.pop_back();
+    }
+
+    // keys view the text of the entries, which don't move in the list
+    entries_.push_front(Entry {
+        .text_utf8 = std::string {text_utf8},
+        .shaped = HbShapedText {text_utf8, font_, options_},
+    });
+    index_.emplace(entries_.front().text_utf8, entries_.begin());
+
+    return entries_.front().shaped;
+}
+
+auto ShapedTextCache::size() const noexcept -> std::size_t {
+    return entries_.size();
+}
+
+auto ShapedTextCache::capacity() const noexcept -> std::size_t {
+    return capacity_;
+}
+
+auto ShapedTextCache::hits() const noexcept -> uint64_t {
+    return hits_;
+}
+
+auto ShapedTextCache::misses() const noexcept -> uint64_t {
+    return misses_;
+}
+
+auto ShapedTextCache::clear() -> void {
+    index_.clear();
+    entries_.clear();
+}
+
+auto ShapedTextCache::memory_usage() const -> std::size_t {
+    // list nodes link two pointers, map nodes a pointer and the cached hash
+    constexpr auto list_node_overhead = 2 * sizeof(void *);
+    constexpr auto map_node_size = sizeof(void *) + sizeof(std::size_t) +
+                                   sizeof(decltype(index_)::value_type);
+
+    auto result = sizeof(ShapedTextCache) + heap_usage(options_.features) +
+                  index_.bucket_count() * sizeof(void *) + index_.size() * map_node_size;
+    for (const auto &entry : entries_) {
+        result += list_node_overhead + sizeof(std::string) + heap_usage(entry.text_utf8) +
+                  entry.shaped.memory_usage();
+    }
+    return result;
+}
+
+//
+// Pooled Shaper
+//
+
+auto ShapedTextBuffer::empty() const -> bool {
+    return codepoints_.empty();
+}
+
+auto ShapedTextBuffer::glyph_run() const noexcept -> BLGlyphRun {
+    return make_glyph_run(codepoints_, placements_);
+}
+
+auto ShapedTextBuffer::clusters() const noexcept -> std::span<const uint32_t> {
+    return clusters_;
+}
+
+auto ShapedTextBuffer::advance() const noexcept -> BLPoint {
+    return advance_;
+}
+
+auto ShapedTextBuffer::bounding_box() const noexcept -> BLBox {
+    return bounding_box_;
+}
+
+auto ShapedTextBuffer::reserve(std::size_t glyph_count) -> void {
+    codepoints_.reserve(glyph_count);
+    placements_.reserve(glyph_count);
+    clusters_.reserve(glyph_count);
+}
+
+auto ShapedTextBuffer::clear() -> void {
+    codepoints_.clear();
+    placements_.clear();
+    clusters_.clear();
+    advance_ = BLPoint {};
+    bounding_box_ = BLBox {};
+}
+
+namespace detail {
+
+struct ShaperState {
+    HbBufferPointer buffer {};
+    std::vector<hb_feature_t> hb_features {};
+};
+
+}  // namespace detail
+
+Shaper::Shaper() = default;
+
+Shaper::Shaper(const Font &font, std::span<const FontFeature> features)
+    : font_ {font},
+      state_ {std::make_unique<detail::ShaperState>(detail::ShaperState {
+          .buffer = HbBufferPointer {hb_buffer_create()},
+          .hb_features = to_hb_features(features),
+      })} {
+    expects(state_->buffer != nullptr);
+}
+
+Shaper::Shaper(Shaper &&) noexcept = default;
+
+auto Shaper::operator=(Shaper &&) noexcept -> Shaper & = default;
+
+Shaper::~Shaper() = default;
+
+auto Shaper::shape(std::string_view text_utf8, ShapedTextBuffer &output) -> void {
+    expects(state_ != nullptr);
+
+    auto *hb_font = font_.hb_font.hb_font();
+    auto *buffer = state_->buffer.get();
+
+    shape_text_item(buffer, text_utf8, 0, text_utf8.size(), hb_font,
+                    state_->hb_features);
+
+    // resizing within the capacity of earlier texts doesn't allocate
+    const auto count = std::size_t {hb_buffer_get_length(buffer)};
+    output.codepoints_.resize(count);
+    output.placements_.resize(count);
+    output.clusters_.resize(count);
+
+    const auto advance =
+        extract_glyphs(buffer, output.codepoints_, output.placements_, output.clusters_);
+
+    const auto font_size = font_.bl_font.size();
+    const auto scale = units_to_pixels(hb_font, font_size);
+    output.advance_ = BLPoint {advance.x * scale.x, advance.y * scale.y};
+    output.bounding_box_ = calculate_bounding_rect(
+        output.codepoints_, output.placements_, hb_font, font_size);
+
+    record_shaped_text(count);
+}
+
+//
+// Text Arena
+//
+
+TextArena::TextArena(std::size_t block_glyph_capacity)
+    : block_glyph_capacity_ {block_glyph_capacity},
+      state_ {std::make_unique<detail::ShaperState>(detail::ShaperState {
+          .buffer = HbBufferPointer {hb_buffer_create()},
+      })} {
+    expects(block_glyph_capacity > 0);
+    expects(state_->buffer != nullptr);
+}
+
+TextArena::TextArena(TextArena &&) noexcept = default;
+
+auto TextArena::operator=(TextArena &&) noexcept -> TextArena & = default;
+
+TextArena::~TextArena() = default;
+
+auto TextArena::allocate(std::size_t glyph_count) -> Block & {
+    if (!blocks_.empty() &&
+        blocks_[block_index_].used + glyph_count <= blocks_[block_index_].capacity) {
+        return blocks_[block_index_];
+    }
+
+    // blocks after the current one are reused, unless they are too small
+    const auto next_index = blocks_.empty() ? 0 : block_index_ + 1;
+    const auto capacity = std::max(block_glyph_capacity_, glyph_count);
+
+    if (next_index == blocks_.size()) {
+        blocks_.emplace_back();
+    }
+    auto &block = blocks_[next_index];
+
+    if (block.capacity < glyph_count) {
+        block.codepoints = std::make_unique_for_overwrite<uint32_t[]>(capacity);
+        block.placements = std::make_unique_for_overwrite<BLGlyphPlacement[]>(capacity);
+        block.clusters = std::make_unique_for_overwrite<uint32_t[]>(capacity);
+        block.capacity = capacity;
+    }
+    block.used = 0;
+    block_index_ = next_index;
+
+    return block;
+}
+
+auto TextArena::shape(std::string_view text_utf8, const Font &font,
+                      std::span<const FontFeature> features) -> ShapedTextView {
+    expects(state_ != nullptr);
+
+    auto *hb_font = font.hb_font.hb_font();
+    auto *buffer = state_->buffer.get();
+
+    to_hb_features(features, state_->hb_features);
+    shape_text_item(buffer, text_utf8, 0, text_utf8.size(), hb_font,
+                    state_->hb_features);
+
+    const auto count = std::size_t {hb_buffer_get_length(buffer)};
+    auto &block = allocate(count);
+
+    const auto codepoints = std::span {block.codepoints.get() + block.used, count};
+    const auto placements = std::span {block.placements.get() + block.used, count};
+    const auto clusters = std::span {block.clusters.get() + block.used, count};
+    block.used += count;
+    glyph_count_ += count;
+
+    const auto advance = extract_glyphs(buffer, codepoints, placements, clusters);
+
+    const auto font_size = font.bl_font.size();
+    const auto scale = units_to_pixels(hb_font, font_size);
+    const auto box = calculate_bounding_rect(codepoints, placements, hb_font, font_size);
+    record_shaped_text(count);
+
+    return ShapedTextView {
+        .glyph_run = make_glyph_run(codepoints, placements),
+        .clusters = clusters,
+        .advance = BLPoint {advance.x * scale.x, advance.y * scale.y},
+        .bounding_box = box,
+    };
+}
+
+auto TextArena::reset() noexcept -> void {
+    if (!blocks_.empty()) {
+        blocks_.front().used = 0;
+    }
+    block_index_ = 0;
+    glyph_count_ = 0;
+}
+
+auto TextArena::glyph_count() const noexcept -> std::size_t {
+    return glyph_count_;
+}
+
+auto TextArena::memory_usage() const -> std::size_t {
+    auto result = sizeof(TextArena) + blocks_.capacity() * sizeof(Block);
+
+    for (const auto &block : blocks_) {
+        result += block.capacity * (2 * sizeof(uint32_t) + sizeof(BLGlyphPlacement));
+    }
+    if (state_) {
+        result += sizeof(detail::ShaperState) + heap_usage(state_->hb_features);
+    }
+    return result;
+}
+
+//
+// Compact Shaped Text
+//
+
+CompactShapedText::CompactShapedText(const HbShapedText &text)
+    : CompactShapedText {text.glyph_run(), text.bounding_box(), text.advance()} {}
+
+CompactShapedText::CompactShapedText(const BLGlyphRun &glyph_run,
+                                     const BLBox &bounding_box, const BLPoint &advance)
+    : bounding_box_ {bounding_box}, advance_ {advance} {
+    const auto codepoints = get_codepoints(glyph_run);
+    const auto placements = get_placements(glyph_run);
+    expects(codepoints.size() == placements.size());
+
+    if (std::ranges::all_of(codepoints, [](uint32_t codepoint) {
+            return codepoint <= std::numeric_limits<uint16_t>::max();
+        })) {
+        glyph_ids_.reserve(codepoints.size());
+        std::ranges::transform(
+            codepoints, std::back_inserter(glyph_ids_),
+            [](uint32_t codepoint) { return narrow<uint16_t>(codepoint); });
+    } else {
+        wide_glyph_ids_.assign(codepoints.begin(), codepoints.end());
+    }
+
+    const auto fits_x_advance = [](const BLGlyphPlacement &pos) {
+        return pos.placement.x == 0 && pos.placement.y == 0 && pos.advance.y == 0 &&
+               pos.advance.x >= std::numeric_limits<int16_t>::min() &&
+               pos.advance.x <= std::numeric_limits<int16_t>::max();
+    };
+
+    x_advances_.reserve(placements.size());
+    for (std::size_t i = 0; i < placements.size(); ++i) {
+        const auto &pos = placements[i];
+
+        if (fits_x_advance(pos)) {
+            x_advances_.push_back(narrow<int16_t>(pos.advance.x));
+        } else {
+            x_advances_.push_back(0);
+            sparse_placements_.push_back(SparsePlacement {
+                .index = narrow<uint32_t>(i),
+                .placement = pos,
+            });
+        }
+    }
+}
+
+auto CompactShapedText::empty() const -> bool {
+    return x_advances_.empty();
+}
+
+auto CompactShapedText::size() const -> std::size_t {
+    return x_advances_.size();
+}
+
+auto CompactShapedText::bounding_box() const noexcept -> BLBox {
+    return bounding_box_;
+}
+
+auto CompactShapedText::advance() const noexcept -> BLPoint {
+    return advance_;
+}
+
+auto CompactShapedText::expand(ShapedTextBuffer &output) const -> void {
+    const auto count = x_advances_.size();
+
+    output.codepoints_.resize(count);
+    output.placements_.resize(count);
+    output.clusters_.clear();
+
+    if (wide_glyph_ids_.empty()) {
+        std::ranges::copy(glyph_ids_, output.codepoints_.begin());
+    } else {
+        std::ranges::copy(wide_glyph_ids_, output.codepoints_.begin());
+    }
+
+    const auto to_placement = [](int16_t x_advance) {
+        return BLGlyphPlacement {
+            .placement = BLPointI {0, 0},
+            .advance = BLPointI {x_advance, 0},
+        };
+    };
+    std::ranges::transform(x_advances_, output.placements_.begin(), to_placement);
+    for (const auto &sparse : sparse_placements_) {
+        output.placements_[sparse.index] = sparse.placement;
+    }
+
+    output.advance_ = advance_;
+    output.bounding_box_ = bounding_box_;
+}
+
+auto CompactShapedText::memory_usage() const -> std::size_t {
+    return sizeof(CompactShapedText) + heap_usage(glyph_ids_) +
+           heap_usage(wide_glyph_ids_) + heap_usage(x_advances_) +
+           heap_usage(sparse_placements_);
+}
+
+//
+// Shaped Text Store
+//
+
+namespace {
+
+// rounds outwards, so the result contains the value
+[[nodiscard]] auto to_int16_pixels(double value, bool round_up) -> int16_t {
+    using limits = std::numeric_limits<int16_t>;
+
+    const auto rounded = round_up ? std::ceil(value) : std::floor(value);
+    return static_cast<int16_t>(
+        std::clamp(rounded, double {limits::min()}, double {limits::max()}));
+}
+
+}  // namespace
+
+auto ShapedTextStore::append(const HbShapedText &text) -> ShapedTextHandle {
+    return append(text.glyph_run(), text.bounding_box());
+}
+
+auto ShapedTextStore::append(const BLGlyphRun &glyph_run, const BLBox &bounding_box)
+    -> ShapedTextHandle {
+    const auto codepoints = get_codepoints(glyph_run);
+    const auto placements = get_placements(glyph_run);
+    expects(codepoints.size() == placements.size());
+
+    const auto offset = narrow<uint32_t>(codepoints_.size());
+    const auto count = narrow<uint32_t>(codepoints.size());
+    expects(offset + std::size_t {count} < erased_offset);
+
+    codepoints_.insert(codepoints_.end(), codepoints.begin(), codepoints.end());
+    placements_.insert(placements_.end(), placements.begin(), placements.end());
+
+    const auto entry = Entry {
+        .offset = offset,
+        .count = count,
+        .x0 = to_int16_pixels(bounding_box.x0, false),
+        .y0 = to_int16_pixels(bounding_box.y0, false),
+        .x1 = to_int16_pixels(bounding_box.x1, true),
+        .y1 = to_int16_pixels(bounding_box.y1, true),
+    };
+
+    if (!free_handles_.empty()) {
+        const auto index = free_handles_.back();
+        free_handles_.pop_back();
+
+        entries_[index] = entry;
+        return ShapedTextHandle {index};
+    }
+
+    const auto index = narrow<uint32_t>(entries_.size());
+    entries_.push_back(entry);
+    return ShapedTextHandle {index};
+}
+
+auto ShapedTextStore::erase(ShapedTextHandle handle) -> void {
+    expects(contains(handle));
+
+    erased_glyph_count_ += entries_[handle.index].count;
+
+    entries_[handle.index] = Entry {.offset = erased_offset};
+    free_handles_.push_back(handle.index);
+}
+
+auto ShapedTextStore::compact() -> void {
+    auto codepoints = std::vector<uint32_t> {};
+    auto placements = std::vector<BLGlyphPlacement> {};
+    codepoints.reserve(glyph_count());
+    placements.reserve(glyph_count());
+
+    // texts are copied in handle order, which is also the append order
+    // unless handles were reused
+    for (auto &entry : entries_) {
+        if (entry.offset == erased_offset) {
+            continue;
+        }
+        const auto begin = std::size_t {entry.offset};
+        const auto end = begin + entry.count;
+
+        entry.offset = narrow<uint32_t>(codepoints.size());
+        codepoints.insert(codepoints.end(), codepoints_.begin() + begin,
+                          codepoints_.begin() + end);
+        placements.insert(placements.end(), placements_.begin() + begin,
+                          placements_.begin() + end);
+    }
+
+    codepoints_ = std::move(codepoints);
+    placements_ = std::move(placements);
+    erased_glyph_count_ = 0;
+
+    // trailing erased handles are dropped
+    while (!entries_.empty() && entries_.back().offset == erased_offset) {
+        entries_.pop_back();
+    }
+    std::erase_if(free_handles_,
+                  [size = entries_.size()](uint32_t index) { return index >= size; });
+
+    entries_.shrink_to_fit();
+    free_handles_.shrink_to_fit();
+}
+
+auto ShapedTextStore::clear() -> void {
+    codepoints_.clear();
+    placements_.clear();
+    entries_.clear();
+    free_handles_.clear();
+    erased_glyph_count_ = 0;
+}
+
+auto ShapedTextStore::contains(ShapedTextHandle handle) const -> bool {
+    return handle.index < entries_.size() &&
+           entries_[handle.index].offset != erased_offset;
+}
+
+auto ShapedTextStore::glyph_run(ShapedTextHandle handle) const -> BLGlyphRun {
+    expects(contains(handle));
+
+    const auto offset = std::size_t {entries_[handle.index].offset};
+    const auto count = std::size_t {entries_[handle.index].count};
+
+    return make_glyph_run(std::span {codepoints_}.subspan(offset, count),
+                          std::span {placements_}.subspan(offset, count));
+}
+
+auto ShapedTextStore::bounding_box(ShapedTextHandle handle) const -> BLBox {
+    expects(contains(handle));
+
+    const auto &entry = entries_[handle.index];
+    return BLBox {static_cast<double>(entry.x0), static_cast<double>(entry.y0),
+                  static_cast<double>(entry.x1), static_cast<double>(entry.y1)};
+}
+
+auto ShapedTextStore::handle_count() const noexcept -> std::size_t {
+    return entries_.size();
+}
+
+auto ShapedTextStore::size() const noexcept -> std::size_t {
+    return entries_.size() - free_handles_.size();
+}
+
+auto ShapedTextStore::glyph_count() const noexcept -> std::size_t {
+    return codepoints_.size() - erased_glyph_count_;
+}
+
+auto ShapedTextStore::erased_glyph_count() const noexcept -> std::size_t {
+    return erased_glyph_count_;
+}
+
+auto ShapedTextStore::memory_usage() const -> std::size_t {
+    return sizeof(ShapedTextStore) + heap_usage(codepoints_) + heap_usage(placements_) +
+           heap_usage(entries_) + heap_usage(free_handles_);
+}
+
+//
+// Shaped Text File
+//
+
+namespace {
+
+constexpr auto shaped_text_file_magic =
+    std::array {'B', '2', 'D', 'S', 'H', 'A', 'P', 'E'};
+constexpr auto shaped_text_file_version = uint32_t {1};
+
+// followed by the entries sorted by text hash, codepoints, placements,
+// clusters and the texts
+struct FileHeader {
+    std::array<char, 8> magic {};
+    uint32_t version {};
+    uint32_t entry_count {};
+    uint64_t face_hash {};
+    uint64_t options_hash {};
+    uint64_t glyph_count {};
+    uint64_t text_size {};
+};
+
+struct FileEntry {
+    uint64_t text_hash {};
+    uint32_t text_offset {};
+    uint32_t text_length {};
+    uint32_t glyph_offset {};
+    uint32_t glyph_count {};
+    BLBox bounding_box {};
+    BLPoint advance {};
+};
+
+static_assert(std::is_trivially_copyable_v<FileHeader>);
+static_assert(std::is_trivially_copyable_v<FileEntry>);
+static_assert(sizeof(FileHeader) % alignof(FileEntry) == 0);
+static_assert(sizeof(FileEntry) % alignof(BLGlyphPlacement) == 0);
+
+constexpr auto hash_seed = uint64_t {0xcbf29ce484222325};
+constexpr auto hash_prime = uint64_t {0x100000001b3};
+
+// FNV-1a over eight bytes per step, not cryptographic
+[[nodiscard]] auto hash_bytes(std::span<const std::byte> data, uint64_t hash = hash_seed)
+    -> uint64_t {
+    auto i = std::size_t {0};
+
+    for (; i + sizeof(uint64_t) <= data.size(); i += sizeof(uint64_t)) {
+        auto word = uint64_t {};
+        std::memcpy(&word, data.data() + i, sizeof(word));
+        hash = (hash ^ word) * hash_prime;
+        hash ^= hash >> 32;
+    }
+    for (; i < data.size(); ++i) {
+        hash = (hash ^ std::to_integer<uint64_t>(data[i])) * hash_prime;
+    }
+
+    return hash;
+}
+
+template <typename T>
+    requires std::is_trivially_copyable_v<T>
+[[nodiscard]] auto hash_value(const T &value, uint64_t hash) -> uint64_t {
+    return hash_bytes(std::as_bytes(std::span {&value, 1}), hash);
+}
+
+[[nodiscard]] auto hash_text(std::string_view text_utf8) -> uint64_t {
+    return hash_bytes(std::as_bytes(std::span {text_utf8}));
+}
+
+[[nodiscard]] auto options_hash(const ShapingOptions &options, float font_size)
+    -> uint64_t {
+    auto hash = hash_value(font_size, hash_seed);
+    hash = hash_value(options.backend_policy, hash);
+    hash = hash_value(options.quality, hash);
+
+    for (const auto &feature : options.features) {
+        hash = hash_value(feature.tag, hash);
+        hash = hash_value(feature.value, hash);
+    }
+    return hash;
+}
+
+// size of the file the header describes, nullopt if it overflows
+[[nodiscard]] auto file_size(const FileHeader &header) -> std::optional<uint64_t> {
+    constexpr auto glyph_size =
+        uint64_t {2 * sizeof(uint32_t) + sizeof(BLGlyphPlacement)};
+    constexpr auto max_size = std::numeric_limits<uint64_t>::max();
+
+    // the entry count has 32 bits, so its product fits
+    auto size = uint64_t {sizeof(FileHeader)} +
+                uint64_t {header.entry_count} * uint64_t {sizeof(FileEntry)};
+    if (header.glyph_count > (max_size - size) / glyph_size) {
+        return std::nullopt;
+    }
+    size += header.glyph_count * glyph_size;
+    if (header.text_size > max_size - size) {
+        return std::nullopt;
+    }
+    return size + header.text_size;
+}
+
+// returns an empty span if the file can't be mapped
+[[nodiscard]] auto map_file(const char *filename) -> std::span<const std::byte> {
+#ifdef _WIN32
+    const auto file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, nullptr,
+                                  OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return {};
+    }
+    auto size = LARGE_INTEGER {};
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+        CloseHandle(file);
+        return {};
+    }
+    const auto mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(file);
+    if (mapping == nullptr) {
+        return {};
+    }
+    // the view keeps the mapping alive
+    const auto *data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);
+    if (data == nullptr) {
+        return {};
+    }
+    return {static_cast<const std::byte *>(data),
+            static_cast<std::size_t>(size.QuadPart)};
+#else
+    const auto file = ::open(filename, O_RDONLY);
+    if (file < 0) {
+        return {};
+    }
+    struct stat info {};
+    if (::fstat(file, &info) != 0 || info.st_size == 0) {
+        ::close(file);
+        return {};
+    }
+    const auto size = static_cast<std::size_t>(info.st_size);
+    // the mapping stays valid after closing the file
+    auto *data = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file, 0);
+    ::close(file);
+    if (data == MAP_FAILED) {
+        return {};
+    }
+    return {static_cast<const std::byte *>(data), size};
+#endif
+}
+
+auto unmap_file(std::span<const std::byte> data) -> void {
+    if (data.empty()) {
+        return;
+    }
+#ifdef _WIN32
+    UnmapViewOfFile(data.data());
+#else
+    ::munmap(const_cast<std::byte *>(data.data()), data.size());
+#endif
+}
+
+hb_user_data_key_t face_hash_key {};
+
+[[nodiscard]] auto compute_face_hash(hb_face_t *hb_face) -> uint64_t {
+    const auto blob = HbBlobPointer {hb_face_reference_blob(hb_face)};
+    auto length = 0u;
+    const auto *data = hb_blob_get_data(blob.get(), &length);
+
+    const auto hash = hash_bytes(std::as_bytes(std::span {data, std::size_t {length}}));
+    return hash_value(hb_face_get_index(hb_face), hash);
+}
+
+// hashed once, the hash is stored on the face and freed with it
+[[nodiscard]] auto hash_face(hb_face_t *hb_face) -> uint64_t {
+    expects(hb_face != nullptr);
+
+    const auto *cached =
+        static_cast<const uint64_t *>(hb_face_get_user_data(hb_face, &face_hash_key));
+    if (cached != nullptr) {
+        return *cached;
+    }
+
+    auto hash = std::make_unique<uint64_t>(compute_face_hash(hb_face));
+    const auto result = *hash;
+    const auto destroy = [](void *data) { delete static_cast<uint64_t *>(data); };
+
+    // fails for the empty face, or if another thread stored it first
+    if (hb_face_set_user_data(hb_face, &face_hash_key, hash.get(), destroy, false)) {
+        static_cast<void>(hash.release());
+    }
+    return result;
+}
+
+// the font keeps its face alive
+[[nodiscard]] auto hash_face(const Font &font) -> uint64_t {
+    return hash_face(hb_font_get_face(font.hb_font.hb_font()));
+}
+
+template <typename T>
+auto write_values(std::ofstream &stream, std::span<const T> values) -> void {
+    const auto bytes = std::as_bytes(values);
+    stream.write(reinterpret_cast<const char *>(bytes.data()),
+                 narrow<std::streamsize>(bytes.size()));
+}
+
+}  // namespace
+
+namespace detail {
+
+struct MappedFile {
+    std::span<const std::byte> data {};
+
+    std::span<const FileEntry> entries {};
+    const uint32_t *codepoints {};
+    const BLGlyphPlacement *placements {};
+    const uint32_t *clusters {};
+    std::size_t glyph_count {};
+    std::span<const char> text {};
+
+    explicit MappedFile(std::span<const std::byte> data_) : data {data_} {}
+
+    MappedFile(const MappedFile &) = delete;
+    auto operator=(const MappedFile &) -> MappedFile & = delete;
+
+    ~MappedFile() {
+        unmap_file(data);
+    }
+};
+
+}  // namespace detail
+
+auto content_hash(const HbFontFace &face) -> uint64_t {
+    return hash_face(face.hb_face());
+}
+
+auto write_shaped_text_file(const char *filename,
+                            std::span<const EditableShapedText> texts) -> void {
+    const auto span = TraceSpan {"write_shaped_text_file"};
+    expects(!texts.empty());
+
+    // the file is keyed by the first text, all others need to match it
+    const auto &font = texts.front().font();
+    const auto &options = texts.front().options();
+    const auto font_size = font.bl_font.size();
+    const auto face_hash = hash_face(font);
+
+    auto entries = std::vector<FileEntry> {};
+    entries.reserve(texts.size());
+
+    auto glyph_count = std::size_t {0};
+    auto text_size = std::size_t {0};
+
+    for (const auto &text : texts) {
+        const auto &shaped = text.shaped();
+        expects(text.font().bl_font.size() == font_size);
+        expects(hash_face(text.font()) == face_hash);
+        expects(text.options() == options);
+        expects(shaped.clusters().size() == shaped.glyph_run().size);
+
+        entries.push_back(FileEntry {
+            .text_hash = hash_text(text.text_utf8()),
+            .text_offset = narrow<uint32_t>(text_size),
+            .text_length = narrow<uint32_t>(text.text_utf8().size()),
+            .glyph_offset = narrow<uint32_t>(glyph_count),
+            .glyph_count = narrow<uint32_t>(shaped.glyph_run().size),
+            .bounding_box = shaped.bounding_box(),
+            .advance = shaped.advance(),
+        });
+
+        glyph_count += shaped.glyph_run().size;
+        text_size += text.text_utf8().size();
+    }
+    // arrays stay in text order, only the entries are sorted for lookups
+    std::ranges::stable_sort(entries, {}, &FileEntry::text_hash);
+
+    const auto header = FileHeader {
+        .magic = shaped_text_file_magic,
+        .version = shaped_text_file_version,
+        .entry_count = narrow<uint32_t>(entries.size()),
+        .face_hash = face_hash,
+        .options_hash = options_hash(options, font_size),
+        .glyph_count = glyph_count,
+        .text_size = text_size,
+    };
+
+    auto stream = std::ofstream {filename, std::ios::binary | std::ios::trunc};
+    if (!stream) {
+        throw std::runtime_error("Unable to open shaped text file for writing");
+    }
+
+    write_values(stream, std::span {&header, 1});
+    write_values(stream, std::span<const FileEntry> {entries});
+    for (const auto &text : texts) {
+        write_values(stream, get_codepoints(text.shaped().glyph_run()));
+    }
+    for (const auto &text : texts) {
+        write_values(stream, get_placements(text.shaped().glyph_run()));
+    }
+    for (const auto &text : texts) {
+        write_values(stream, text.shaped().clusters());
+    }
+    for (const auto &text : texts) {
+        write_values(stream, std::span {text.text_utf8()});
+    }
+
+    if (!stream.flush()) {
+        throw std::runtime_error("Unable to write shaped text file");
+    }
+}
+
+ShapedTextFile::ShapedTextFile() = default;
+
+ShapedTextFile::ShapedTextFile(const char *filename, const Font &font,
+                               const ShapingOptions &options, std::size_t miss_capacity)
+    : missed_ {font, miss_capacity, options} {
+    const auto span = TraceSpan {"open_shaped_text_file"};
+
+    auto file = std::make_unique<detail::MappedFile>(map_file(filename));
+    const auto data = file->data;
+
+    auto header = FileHeader {};
+    if (data.size() < sizeof(header)) {
+        return;
+    }
+    std::memcpy(&header, data.data(), sizeof(header));
+
+    if (header.magic != shaped_text_file_magic ||
+        header.version != shaped_text_file_version || file_size(header) != data.size() ||
+        header.face_hash != hash_face(font) ||
+        header.options_hash != options_hash(options, font.bl_font.size())) {
+        return;
+    }
+
+    const auto *entries = data.data() + sizeof(FileHeader);
+    const auto *codepoints = entries + header.entry_count * sizeof(FileEntry);
+    const auto *placements = codepoints + header.glyph_count * sizeof(uint32_t);
+    const auto *clusters = placements + header.glyph_count * sizeof(BLGlyphPlacement);
+    const auto *text = clusters + header.glyph_count * sizeof(uint32_t);
+
+    // mappings are page aligned, all arrays are aligned within the file
+    file->entries = std::span {reinterpret_cast<const FileEntry *>(entries),
+                               std::size_t {header.entry_count}};
+    file->codepoints = reinterpret_cast<const uint32_t *>(codepoints);
+    file->placements = reinterpret_cast<const BLGlyphPlacement *>(placements);
+    file->clusters = reinterpret_cast<const uint32_t *>(clusters);
+    file->glyph_count = static_cast<std::size_t>(header.glyph_count);
+    file->text = std::span {reinterpret_cast<const char *>(text),
+                            static_cast<std::size_t>(header.text_size)};
+
+    file_ = std::move(file);
+}
+
+ShapedTextFile::ShapedTextFile(ShapedTextFile &&) noexcept = default;
+
+auto ShapedTextFile::operator=(ShapedTextFile &&) noexcept -> ShapedTextFile & = default;
+
+ShapedTextFile::~ShapedTextFile() = default;
+
+auto ShapedTextFile::stale() const noexcept -> bool {
+    return file_ == nullptr;
+}
+
+auto ShapedTextFile::size() const noexcept -> std::size_t {
+    return file_ == nullptr ? 0 : file_->entries.size();
+}
+
+auto ShapedTextFile::find(std::string_view text_utf8) const
+    -> std::optional<ShapedTextView> {
+    if (file_ == nullptr) {
+        return std::nullopt;
+    }
+    const auto &file = *file_;
+    const auto matches = std::ranges::equal_range(file.entries, hash_text(text_utf8), {},
+                                                  &FileEntry::text_hash);
+
+    for (const auto &entry : matches) {
+        // damaged entries miss
+        if (uint64_t {entry.text_offset} + entry.text_length > file.text.size() ||
+            uint64_t {entry.glyph_offset} + entry.glyph_count > file.glyph_count) {
+            continue;
+        }
+        if (std::string_view {file.text.data() + entry.text_offset, entry.text_length} !=
+            text_utf8) {
+            continue;
+        }
+
+        const auto codepoints = std::span {file.codepoints + entry.glyph_offset,
+                                           std::size_t {entry.glyph_count}};
+        const auto placements = std::span {file.placements + entry.glyph_offset,
+                                           std::size_t {entry.glyph_count}};
+
+        return ShapedTextView {
+            .glyph_run = make_glyph_run(codepoints, placements),
+            .clusters = std::span {file.clusters + entry.glyph_offset,
+                                   std::size_t {entry.glyph_count}},
+            .advance = entry.advance,
+            .bounding_box = entry.bounding_box,
+        };
+    }
+
+    return std::nullopt;
+}
+
+auto ShapedTextFile::find_or_shape(std::string_view text_utf8) -> ShapedTextView {
+    if (const auto view = find(text_utf8)) {
+        return *view;
+    }
+
+    const auto &shaped = missed_.get(text_utf8);
+    return ShapedTextView {
+        .glyph_run = shaped.glyph_run(),
+        .clusters = shaped.clusters(),
+        .advance = shaped.advance(),
+        .bounding_box = shaped.bounding_box(),
+    };
+}
+
+auto ShapedTextFile::misses() const noexcept -> uint64_t {
+    return missed_.hits() + missed_.misses();
+}
+
+//
+// Glyph Atlas
+//
+
+namespace {
+
+constexpr auto glyph_atlas_magic = std::array {'B', '2', 'D', 'A', 'T', 'L', 'A', 'S'};
+constexpr auto glyph_atlas_version = uint32_t {1};
+
+// gap between masks, so filtering doesn't bleed into neighbors
+constexpr auto atlas_padding = 1;
+
+// followed by the entries and the rows of the A8 image
+struct AtlasFileHeader {
+    std::array<char, 8> magic {};
+    uint32_t version {};
+    uint32_t entry_count {};
+    int32_t width {};
+    int32_t height {};
+    int32_t shelf_x {};
+    int32_t shelf_y {};
+    int32_t shelf_height {};
+    uint32_t reserved {};
+};
+
+struct AtlasFileEntry {
+    uint64_t face_hash {};
+    float font_size {};
+    uint32_t glyph_id {};
+    uint32_t subpixel_bin {};
+    BLRectI rect {};
+    BLPointI offset {};
+    uint32_t reserved {};
+};
+
+static_assert(std::is_trivially_copyable_v<AtlasFileHeader>);
+static_assert(std::is_trivially_copyable_v<AtlasFileEntry>);
+static_assert(sizeof(AtlasFileHeader) % alignof(AtlasFileEntry) == 0);
+
+// pixel area of the glyph drawn at the pen position plus the subpixel offset
+[[nodiscard]] auto glyph_pixel_box(const Font &font, uint32_t glyph_id, double subpixel)
+    -> std::optional<BLBoxI> {
+    auto *hb_font = font.hb_font.hb_font();
+    const auto pos = BLGlyphPlacement {};
+
+    const auto box = get_glyph_box(hb_font, glyph_id, BLPoint {}, pos);
+    if (!box) {
+        return std::nullopt;
+    }
+    const auto scale = units_to_pixels(hb_font, font.bl_font.size());
+
+    // antialiasing may touch the neighboring pixels
+    return BLBoxI {
+        static_cast<int>(std::floor(box->x0 * scale.x + subpixel)) - 1,
+        static_cast<int>(std::floor(box->y0 * scale.y)) - 1,
+        static_cast<int>(std::ceil(box->x1 * scale.x + subpixel)) + 1,
+        static_cast<int>(std::ceil(box->y1 * scale.y)) + 1,
+    };
+}
+
+}  // namespace
+
+auto GlyphAtlas::KeyHash::operator()(const Key &key) const noexcept -> std::size_t {
+    auto hash = hash_value(key.face_hash, hash_seed);
+    hash = hash_value(key.font_size, hash);
+    hash = hash_value(key.glyph_id, hash);
+    hash = hash_value(key.subpixel_bin, hash);
+    return static_cast<std::size_t>(hash);
+}
+
+GlyphAtlas::GlyphAtlas(int width, int height) {
+    expects(width > 0 && height > 0);
+
+    if (image_.create(width, height, BL_FORMAT_A8) != BL_SUCCESS) {
+        throw std::runtime_error("Unable to create glyph atlas image");
+    }
+    clear();
+}
+
+auto GlyphAtlas::allocate(int width, int height) -> std::optional<BLRectI> {
+    const auto padded_width = width + atlas_padding;
+    const auto padded_height = height + atlas_padding;
+
+    if (padded_width > image_.width()) {
+        return std::nullopt;
+    }
+
+    // start a new shelf below the current one
+    if (shelf_x_ + padded_width > image_.width()) {
+        shelf_y_ += shelf_height_;
+        shelf_x_ = 0;
+        shelf_height_ = 0;
+    }
+    if (shelf_y_ + padded_height > image_.height()) {
+        return std::nullopt;
+    }
+
+    const auto rect = BLRectI {shelf_x_, shelf_y_, width, height};
+    shelf_x_ += padded_width;
+    shelf_height_ = std::max(shelf_height_, padded_height);
+
+    return rect;
+}
+
+auto GlyphAtlas::glyph(const Font &font, uint32_t glyph_id, uint32_t subpixel_bin)
+    -> std::optional<AtlasGlyph> {
+    expects(subpixel_bin < subpixel_bins);
+
+    const auto key = Key {
+        .face_hash = hash_face(font),
+        .font_size = font.bl_font.size(),
+        .glyph_id = glyph_id,
+        .subpixel_bin = subpixel_bin,
+    };
+    if (const auto it = glyphs_.find(key); it != glyphs_.end()) {
+        return it->second;
+    }
+
+    const auto subpixel = static_cast<double>(subpixel_bin) / subpixel_bins;
+    const auto box = glyph_pixel_box(font, glyph_id, subpixel);
+
+    // glyphs without ink, like spaces, need no area
+    if (!box) {
+        return glyphs_.emplace(key, AtlasGlyph {}).first->second;
+    }
+
+    const auto rect = allocate(box->x1 - box->x0, box->y1 - box->y0);
+    if (!rect) {
+        return std::nullopt;
+    }
+
+    const auto glyph_ids = std::array {glyph_id};
+    const auto placements = std::array {BLGlyphPlacement {}};
+
+    auto context = BLContext {image_};
+    context.clipToRect(*rect);
+    context.clearRect(*rect);
+    const auto origin = BLPoint {
+        static_cast<double>(rect->x - box->x0) + subpixel,
+        static_cast<double>(rect->y - box->y0),
+    };
+    context.fillGlyphRun(origin, font.bl_font, make_glyph_run(glyph_ids, placements),
+                         BLRgba32 {0xFFFFFFFF});
+    context.end();
+
+    ++rasterized_count_;
+
+    const auto result = AtlasGlyph {
+        .rect = *rect,
+        .offset = BLPointI {box->x0, box->y0},
+    };
+    return glyphs_.emplace(key, result).first->second;
+}
+
+auto GlyphAtlas::image() const noexcept -> const BLImage & {
+    return image_;
+}
+
+auto GlyphAtlas::size() const noexcept -> std::size_t {
+    return glyphs_.size();
+}
+
+auto GlyphAtlas::rasterized_count() const noexcept -> std::size_t {
+    return rasterized_count_;
+}
+
+auto GlyphAtlas::clear() -> void {
+    auto context = BLContext {image_};
+    context.clearAll();
+    context.end();
+
+    glyphs_.clear();
+    rasterized_count_ = 0;
+    shelf_x_ = 0;
+    shelf_y_ = 0;
+    shelf_height_ = 0;
+}
+
+auto GlyphAtlas::save(const char *filename) const -> void {
+    const auto span = TraceSpan {"save_glyph_atlas"};
+
+    auto data = BLImageData {};
+    if (image_.getData(&data) != BL_SUCCESS) {
+        throw std::runtime_error("Unable to access glyph atlas image");
+    }
+
+    const auto header = AtlasFileHeader {
+        .magic = glyph_atlas_magic,
+        .version = glyph_atlas_version,
+        .entry_count = narrow<uint32_t>(glyphs_.size()),
+        .width = image_.width(),
+        .height = image_.height(),
+        .shelf_x = shelf_x_,
+        .shelf_y = shelf_y_,
+        .shelf_height = shelf_height_,
+    };
+
+    auto entries = std::vector<AtlasFileEntry> {};
+    entries.reserve(glyphs_.size());
+    for (const auto &[key, glyph] : glyphs_) {
+        entries.push_back(AtlasFileEntry {
+            .face_hash = key.face_hash,
+            .font_size = key.font_size,
+            .glyph_id = key.glyph_id,
+            .subpixel_bin = key.subpixel_bin,
+            .rect = glyph.rect,
+            .offset = glyph.offset,
+        });
+    }
+
+    auto stream = std::ofstream {filename, std::ios::binary | std::ios::trunc};
+    if (!stream) {
+        throw std::runtime_error("Unable to open glyph atlas file for writing");
+    }
+
+    write_values(stream, std::span {&header, 1});
+    write_values(stream, std::span<const AtlasFileEntry> {entries});
+
+    const auto *pixels = static_cast<const std::byte *>(data.pixelData);
+    const auto width = static_cast<std::size_t>(image_.width());
+    for (int y = 0; y < image_.height(); ++y) {
+        write_values(stream, std::span {pixels + y * data.stride, width});
+    }
+
+    if (!stream.flush()) {
+        throw std::runtime_error("Unable to write glyph atlas file");
+    }
+}
+
+auto GlyphAtlas::load(const char *filename) -> bool {
+    const auto span = TraceSpan {"load_glyph_atlas"};
+
+    const auto file = detail::MappedFile {map_file(filename)};
+    const auto data = file.data;
+
+    auto header = AtlasFileHeader {};
+    if (data.size() < sizeof(header)) {
+        return false;
+    }
+    std::memcpy(&header, data.data(), sizeof(header));
+
+    const auto width = static_cast<std::size_t>(image_.width());
+    const auto height = static_cast<std::size_t>(image_.height());
+
+    if (header.magic != glyph_atlas_magic || header.version != glyph_atlas_version ||
+        header.width != image_.width() || header.height != image_.height() ||
+        data.size() != sizeof(header) + header.entry_count * sizeof(AtlasFileEntry) +
+                           width * height) {
+        return false;
+    }
+
+    // mappings are page aligned, entries are aligned within the file
+    const auto entries = std::span {
+        reinterpret_cast<const AtlasFileEntry *>(data.data() + sizeof(header)),
+        std::size_t {header.entry_count}};
+
+    const auto is_inside = [&](const BLRectI &rect) {
+        return rect.x >= 0 && rect.y >= 0 && rect.w >= 0 && rect.h >= 0 &&
+               rect.x + rect.w <= header.width && rect.y + rect.h <= header.height;
+    };
+    if (!is_inside(BLRectI {header.shelf_x, header.shelf_y, 0, header.shelf_height}) ||
+        !std::ranges::all_of(entries, is_inside, &AtlasFileEntry::rect)) {
+        return false;
+    }
+
+    auto image_data = BLImageData {};
+    if (image_.makeMutable(&image_data) != BL_SUCCESS) {
+        return false;
+    }
+    const auto *pixels = data.data() + sizeof(header) + entries.size_bytes();
+
+    auto *image_pixels = static_cast<std::byte *>(image_data.pixelData);
+    for (std::size_t y = 0; y < height; ++y) {
+        std::memcpy(image_pixels + y * image_data.stride, pixels + y * width, width);
+    }
+
+    glyphs_.clear();
+    glyphs_.reserve(entries.size());
+    for (const auto &entry : entries) {
+        const auto key = Key {
+            .face_hash = entry.face_hash,
+            .font_size = entry.font_size,
+            .glyph_id = entry.glyph_id,
+            .subpixel_bin = entry.subpixel_bin,
+        };
+        glyphs_.emplace(key, AtlasGlyph {.rect = entry.rect, .offset = entry.offset});
+    }
+
+    rasterized_count_ = 0;
+    shelf_x_ = header.shelf_x;
+    shelf_y_ = header.shelf_y;
+    shelf_height_ = header.shelf_height;
+
+    return true;
+}
+
+//
+// Warmup
+//
+
+namespace {
+
+constexpr auto warmup_profile_magic = std::array {'B', '2', 'D', 'W', 'A', 'R', 'M', 'P'};
+constexpr auto warmup_profile_version = uint32_t {1};
+
+// limits for damaged files
+constexpr auto max_profile_text_length = uint32_t {1} << 16;
+constexpr auto max_profile_feature_count = uint32_t {64};
+
+struct ProfileFileHeader {
+    std::array<char, 8> magic {};
+    uint32_t version {};
+    uint32_t entry_count {};
+};
+
+// followed by the features and the text
+struct ProfileFileEntry {
+    uint64_t face_hash {};
+    float font_size {};
+    uint32_t priority {};
+    uint32_t count {};
+    uint32_t feature_count {};
+    uint32_t text_length {};
+    uint8_t backend_policy {};
+    uint8_t quality {};
+    uint16_t reserved {};
+};
+
+static_assert(std::is_trivially_copyable_v<ProfileFileHeader>);
+static_assert(std::is_trivially_copyable_v<ProfileFileEntry>);
+
+template <typename T>
+    requires std::is_trivially_copyable_v<T>
+auto append_bytes(std::string &key, const T &value) -> void {
+    const auto bytes = std::as_bytes(std::span {&value, 1});
+    key.append(reinterpret_cast<const char *>(bytes.data()), bytes.size());
+}
+
+[[nodiscard]] auto warmup_key(const WarmupEntry &entry) -> std::string {
+    auto key = std::string {};
+    key.reserve(32 + entry.options.features.size() * sizeof(FontFeature) +
+                entry.text_utf8.size());
+
+    append_bytes(key, entry.face_hash);
+    append_bytes(key, entry.font_size);
+    append_bytes(key, entry.options.backend_policy);
+    append_bytes(key, entry.options.quality);
+    append_bytes(key, entry.options.features.size());
+    for (const auto &feature : entry.options.features) {
+        append_bytes(key, feature.tag);
+        append_bytes(key, feature.value);
+    }
+    key.append(entry.text_utf8);
+
+    return key;
+}
+
+template <typename T>
+    requires std::is_trivially_copyable_v<T>
+[[nodiscard]] auto read_value(std::ifstream &stream, T &value) -> bool {
+    return static_cast<bool>(
+        stream.read(reinterpret_cast<char *>(&value), sizeof(value)));
+}
+
+}  // namespace
+
+auto WarmupProfile::add(WarmupEntry entry) -> void {
+    auto key = warmup_key(entry);
+
+    if (const auto it = entries_.find(key); it != entries_.end()) {
+        it->second.count += entry.count;
+        it->second.priority = std::min(it->second.priority, entry.priority);
+        return;
+    }
+    entries_.emplace(std::move(key), std::move(entry));
+}
+
+auto WarmupProfile::record(std::string_view text_utf8, const Font &font,
+                           const ShapingOptions &options, uint32_t priority) -> void {
+    const auto lock = std::lock_guard {mutex_};
+
+    add(WarmupEntry {
+        .text_utf8 = std::string {text_utf8},
+        .face_hash = hash_face(font),
+        .font_size = font.bl_font.size(),
+        .options = options,
+        .priority = priority,
+        .count = 1,
+    });
+}
+
+auto WarmupProfile::entries(std::size_t max_count) const -> std::vector<WarmupEntry> {
+    auto result = std::vector<WarmupEntry> {};
+    {
+        const auto lock = std::lock_guard {mutex_};
+        result.reserve(entries_.size());
+        std::ranges::transform(entries_, std::back_inserter(result),
+                               [](const auto &item) { return item.second; });
+    }
+
+    const auto hotter = [](const WarmupEntry &a, const WarmupEntry &b) {
+        if (a.priority != b.priority) {
+            return a.priority < b.priority;
+        }
+        return a.count > b.count;
+    };
+    std::ranges::stable_sort(result, hotter);
+
+    if (result.size() > max_count) {
+        result.erase(result.begin() + narrow<std::ptrdiff_t>(max_count), result.end());
+    }
+    return result;
+}
+
+auto WarmupProfile::size() const -> std::size_t {
+    const auto lock = std::lock_guard {mutex_};
+    return entries_.size();
+}
+
+auto WarmupProfile::clear() -> void {
+    const auto lock = std::lock_guard {mutex_};
+    entries_.clear();
+}
+
+auto WarmupProfile::save(const char *filename, std::size_t max_count) const -> void {
+    const auto entries = this->entries(max_count);
+
+    auto stream = std::ofstream {filename, std::ios::binary | std::ios::trunc};
+    if (!stream) {
+        throw std::runtime_error("Unable to open warmup profile for writing");
+    }
+
+    const auto header = ProfileFileHeader {
+        .magic = warmup_profile_magic,
+        .version = warmup_profile_version,
+        .entry_count = narrow<uint32_t>(entries.size()),
+    };
+    write_values(stream, std::span {&header, 1});
+
+    for (const auto &entry : entries) {
+        const auto file_entry = ProfileFileEntry {
+            .face_hash = entry.face_hash,
+            .font_size = entry.font_size,
+            .priority = entry.priority,
+            .count = entry.count,
+            .feature_count = narrow<uint32_t>(entry.options.features.size()),
+            .text_length = narrow<uint32_t>(entry.text_utf8.size()),
+            .backend_policy = static_cast<uint8_t>(entry.options.backend_policy),
+            .quality = static_cast<uint8_t>(entry.options.quality),
+        };
+        write_values(stream, std::span {&file_entry, 1});
+        write_values(stream, std::span<const FontFeature> {entry.options.features});
+        write_values(stream, std::span {entry.text_utf8});
+    }
+
+    if (!stream.flush()) {
+        throw std::runtime_error("Unable to write warmup profile");
+    }
+}
+
+auto WarmupProfile::load(const char *filename) -> bool {
+    auto stream = std::ifstream {filename, std::ios::binary};
+
+    auto header = ProfileFileHeader {};
+    if (!read_value(stream, header) || header.magic != warmup_profile_magic ||
+        header.version != warmup_profile_version) {
+        return false;
+    }
+
+    auto entries = std::vector<WarmupEntry> {};
+    entries.reserve(std::min(header.entry_count, uint32_t {1024}));
+
+    for (uint32_t i = 0; i < header.entry_count; ++i) {
+        auto file_entry = ProfileFileEntry {};
+        if (!read_value(stream, file_entry) ||
+            file_entry.feature_count > max_profile_feature_count ||
+            file_entry.text_length > max_profile_text_length ||
+            file_entry.backend_policy >
+                static_cast<uint8_t>(ShapingBackendPolicy::parity_check) ||
+            file_entry.quality > static_cast<uint8_t>(ShapingQuality::monospace)) {
+            return false;
+        }
+
+        auto entry = WarmupEntry {
+            .text_utf8 = std::string(file_entry.text_length, '\0'),
+            .face_hash = file_entry.face_hash,
+            .font_size = file_entry.font_size,
+            .options =
+                ShapingOptions {
+                    .backend_policy =
+                        static_cast<ShapingBackendPolicy>(file_entry.backend_policy),
+                    .quality = static_cast<ShapingQuality>(file_entry.quality),
+                    .features = std::vector<FontFeature>(file_entry.feature_count),
+                },
+            .priority = file_entry.priority,
+            .count = file_entry.count,
+        };
+
+        const auto feature_bytes =
+            std::as_writable_bytes(std::span {entry.options.features});
+        if (!stream.read(reinterpret_cast<char *>(feature_bytes.data()),
+                         narrow<std::streamsize>(feature_bytes.size())) ||
+            !stream.read(entry.text_utf8.data(),
+                         narrow<std::streamsize>(entry.text_utf8.size()))) {
+            return false;
+        }
+        entries.push_back(std::move(entry));
+    }
+
+    const auto lock = std::lock_guard {mutex_};
+    for (auto &entry : entries) {
+        add(std::move(entry));
+    }
+    return true;
+}
+
+auto start_warmup(std::vector<WarmupEntry> entries, std::vector<Font> fonts,
+                  WarmupCallback on_shaped) -> std::jthread {
+    return std::jthread {[entries = std::move(entries), fonts = std::move(fonts),
+                          on_shaped = std::move(on_shaped)](std::stop_token stop_token) {
+        const auto span = TraceSpan {"warmup"};
+
+        auto face_hashes = std::vector<uint64_t> {};
+        face_hashes.reserve(fonts.size());
+        std::ranges::transform(fonts, std::back_inserter(face_hashes),
+                               [](const Font &font) { return hash_face(font); });
+
+        for (const auto &entry : entries) {
+            if (stop_token.stop_requested()) {
+                return;
+            }
+
+            const Font *font = nullptr;
+            for (std::size_t i = 0; i < fonts.size(); ++i) {
+                if (face_hashes[i] == entry.face_hash &&
+                    fonts[i].bl_font.size() == entry.font_size) {
+                    font = &fonts[i];
+                    break;
+                }
+            }
+            if (font == nullptr) {
+                continue;
+            }
+
+            try {
+                auto text = HbShapedText {entry.text_utf8, *font, entry.options};
+                if (on_shaped) {
+                    on_shaped(entry, std::move(text));
+                }
+            } catch (const std::runtime_error &) {
+                // e.g. parity check failures, the text is shaped again when used
+            }
+        }
+    }};
+}
+
+//
+// Memory Usage
+//
+
+auto FaceMemoryUsage::total() const noexcept -> std::size_t {
+    return hb_font_data + bl_font_data;
+}
+
+auto memory_usage(const FontFace &face) -> FaceMemoryUsage {
+    auto result = FaceMemoryUsage {};
+
+    auto hb_data = std::span<const char> {};
+    if (!face.hb_face.empty()) {
+        const auto blob = HbBlobPointer {hb_face_reference_blob(face.hb_face.hb_face())};
+        auto length = 0U;
+        const auto *data = hb_blob_get_data(blob.get(), &length);
+
+        hb_data = std::span<const char>(data, length);
+        result.hb_font_data = length;
+    }
+    // tables are views of the font data, which can be the buffer HarfBuzz reads
+    const auto is_shared = [&](const BLFontTable &table) {
+        const auto *data = reinterpret_cast<const char *>(table.data);
+        return !hb_data.empty() && !std::less {}(data, hb_data.data()) &&
+               std::less {}(data, hb_data.data() + hb_data.size());
+    };
+
+    if (!face.bl_face.empty()) {
+        const auto &data = face.bl_face.data();
+        const auto face_index = face.bl_face.faceInfo().faceIndex;
+
+        auto tags = BLArray<BLTag> {};
+        if (data.getTableTags(face_index, tags) == BL_SUCCESS && !tags.empty()) {
+            auto tables = std::vector<BLFontTable>(tags.size());
+            data.getTables(face_index, tables.data(), tags.data(), tags.size());
+
+            for (const auto &table : tables) {
+                if (!is_shared(table)) {
+                    result.bl_font_data += table.size;
+                }
+            }
+        }
+    }
+
+    return result;
+}
+
+auto MemoryReport::add(const FontFace &face) -> void {
+    // held faces can't be freed, so their addresses are not reused while compared
+    const auto *hb_face = face.hb_face.hb_face();
+    if (std::ranges::find(faces_, hb_face, &HbFontFace::hb_face) != faces_.end()) {
+        return;
+    }
+    faces_.push_back(face.hb_face);
+    face_bytes_ += memory_usage(face).total();
+}
+
+auto MemoryReport::add(const HbShapedText &text) -> void {
+    shaped_text_bytes_ += text.memory_usage();
+}
+
+auto MemoryReport::add(const ShapedTextStore &store) -> void {
+    shaped_text_bytes_ += store.memory_usage();
+}
+
+auto MemoryReport::add(const CompactShapedText &text) -> void {
+    shaped_text_bytes_ += text.memory_usage();
+}
+
+auto MemoryReport::add(const ShapedTextCache &cache) -> void {
+    cache_bytes_ += cache.memory_usage();
+}
+
+auto MemoryReport::face_bytes() const noexcept -> std::size_t {
+    return face_bytes_;
+}
+
+auto MemoryReport::shaped_text_bytes() const noexcept -> std::size_t {
+    return shaped_text_bytes_;
+}
+
+auto MemoryReport::cache_bytes() const noexcept -> std::size_t {
+    return cache_bytes_;
+}
+
+auto MemoryReport::total_bytes() const noexcept -> std::size_t {
+    return face_bytes_ + shaped_text_bytes_ + cache_bytes_;
+}
+
+//
+// Instrumentation
+//
+
+auto InstrumentationSnapshot::stage(ShapingStage stage) const -> const StageStatistics & {
+    return stages.at(static_cast<std::size_t>(stage));
+}
+
+auto instrumentation_enabled() noexcept -> bool {
+    return instrumentation_compiled;
+}
+
+auto instrumentation_snapshot() -> InstrumentationSnapshot {
+    if constexpr (!instrumentation_compiled) {
+        return InstrumentationSnapshot {};
+    }
+    return counter_registry().snapshot();
+}
+
+//
+// Tracing
+//
+
+auto set_trace_sink(std::shared_ptr<TraceSink> sink) -> void {
+    if constexpr (!tracing_compiled) {
+        return;
+    }
+    thread_trace_buffer().flush();
+
+    auto &state = trace_state();
+    const auto lock = std::scoped_lock {state.mutex};
+    tracing_active.store(sink != nullptr, std::memory_order_relaxed);
+    trace_generation.fetch_add(1, std::memory_order_relaxed);
+    state.sink = std::move(sink);
+}
+
+auto flush_trace_events() -> void {
+    if constexpr (tracing_compiled) {
+        thread_trace_buffer().flush();
+    }
+}
+
+TraceSpan::TraceSpan(const char *name, const char *category)
+    : name_ {name}, category_ {category} {
+    if constexpr (tracing_compiled) {
+        if (tracing_active.load(std::memory_order_relaxed)) {
+            start_ns_ = trace_clock_ns();
+        }
+    }
+}
+
+TraceSpan::~TraceSpan() {
+    if constexpr (tracing_compiled) {
+        if (start_ns_ >= 0) {
+            auto &buffer = thread_trace_buffer();
+            buffer.add(TraceEvent {
+                .name = name_,
+                .category = category_,
+                .thread_id = buffer.thread_id(),
+                .start_ns = start_ns_,
+                .duration_ns = trace_clock_ns() - start_ns_,
+            });
+        }
+    }
+}
+
+namespace {
+
+auto write_json_string(std::ostream &stream, std::string_view value) -> void {
+    constexpr auto digits = std::string_view {"0123456789abcdef"};
+
+    stream << '"';
+    for (const auto c : value) {
+        const auto byte = static_cast<unsigned char>(c);
+        if (c == '"' || c == '\\') {
+            stream << '\\' << c;
+        } else if (byte < 0x20) {
+            stream << "\\u00" << digits[byte >> 4] << digits[byte & 0xF];
+        } else {
+            stream << c;
+        }
+    }
+    stream << '"';
+}
+
+}  // namespace
+
+ChromeTraceWriter::ChromeTraceWriter(const std::string &filename) : file_ {filename} {
+    if (!file_) {
+        throw std::runtime_error("Unable to open trace file " + filename);
+    }
+    file_ << "[\n";
+}
+
+ChromeTraceWriter::~ChromeTraceWriter() {
+    file_ << "\n]\n";
+}
+
+auto ChromeTraceWriter::write(std::span<const TraceEvent> events) -> void {
+    const auto lock = std::scoped_lock {mutex_};
+
+    // complete events with timestamps in microseconds
+    for (const auto &event : events) {
+        file_ << (first_ ? "" : ",\n") << R"({"name":)";
+        write_json_string(file_, event.name);
+        file_ << R"(,"cat":)";
+        write_json_string(file_, event.category);
+        file_ << R"(,"ph":"X","ts":)" << static_cast<double>(event.start_ns) / 1000.0
+              << R"(,"dur":)" << static_cast<double>(event.duration_ns) / 1000.0
+              << R"(,"pid":1,"tid":)" << event.thread_id << "}";
+        first_ = false;
+    }
+}
+
+//
+// From File
 //
 
 auto create_face_from_file(const char *filename, uint32_t face_index) -> FontFace {
+    const auto span = TraceSpan {"create_face_from_file"};
+    const auto timer = StageTimer {ShapingStage::face_creation};
+
     BLArray<uint8_t> buffer;
     if (const auto result = BLFileSystem::readFile(filename, buffer);
         result != BL_SUCCESS) {
@@ -407,13 +4506,20 @@ auto create_face_from_file(const char *filename, uint32_t face_index) -> FontFac
         throw std::runtime_error("Unable create BLFontFace");
     }
 
+    auto hb_face = HbFontFace {buffer, face_index};
+    const auto fixed_advance = detect_fixed_advance(hb_face);
+
     return FontFace {
         .bl_face = std::move(face),
-        .hb_face = HbFontFace {buffer, face_index},
+        .hb_face = std::move(hb_face),
+        .fixed_advance = fixed_advance,
     };
 }
 
 auto create_font(const FontFace &face, float font_size) -> Font {
+    const auto span = TraceSpan {"create_font"};
+    const auto timer = StageTimer {ShapingStage::font_creation};
+
     BLFont font;
 
     if (const auto result = font.createFromFace(face.bl_face, font_size);
@@ -424,7 +4530,169 @@ auto create_font(const FontFace &face, float font_size) -> Font {
     return Font {
         .bl_font = std::move(font),
         .hb_font = HbFont {face.hb_face},
+        .fixed_advance = face.fixed_advance,
+    };
+}
+
+auto monospace_column_width(const Font &font) -> double {
+    if (font.fixed_advance == 0) {
+        return 0;
+    }
+    const auto scale = units_to_pixels(font.hb_font.hb_font(), font.bl_font.size());
+    return font.fixed_advance * scale.x;
+}
+
+//
+// Font Loader
+//
+
+namespace detail {
+
+struct FontLoadTask {
+    std::string filename {};
+    FontLoadOptions options {};
+    std::stop_token stop_token {};
+    std::promise<FontFace> promise {};
+};
+
+struct FontLoaderState {
+    std::mutex mutex {};
+    std::condition_variable_any condition {};
+    std::deque<FontLoadTask> queue {};
+    std::vector<std::jthread> workers {};
+};
+
+}  // namespace detail
+
+namespace {
+
+[[nodiscard]] auto cancelled_load() -> std::exception_ptr {
+    return std::make_exception_ptr(std::runtime_error("Font loading was cancelled"));
+}
+
+auto prewarm_tables(const HbFontFace &face) -> void {
+    auto *hb_face = face.hb_face();
+
+    // layout accelerators are created on first access
+    static_cast<void>(hb_ot_layout_has_substitution(hb_face));
+    static_cast<void>(hb_ot_layout_has_positioning(hb_face));
+
+    // the cmap accelerator is shared by all fonts of the face
+    const auto font = HbFont {face};
+    auto glyph = hb_codepoint_t {};
+    static_cast<void>(hb_font_get_nominal_glyph(font.hb_font(), 'a', &glyph));
+}
+
+auto run_load_task(detail::FontLoadTask &task) -> void {
+    const auto span = TraceSpan {"load_font_async"};
+
+    try {
+        if (task.stop_token.stop_requested()) {
+            task.promise.set_exception(cancelled_load());
+            return;
+        }
+
+        auto face = create_face_from_file(task.filename.c_str(), task.options.face_index);
+        if (task.options.prewarm_tables && !task.stop_token.stop_requested()) {
+            prewarm_tables(face.hb_face);
+        }
+
+        if (task.stop_token.stop_requested()) {
+            task.promise.set_exception(cancelled_load());
+            return;
+        }
+        task.promise.set_value(std::move(face));
+    } catch (...) {
+        task.promise.set_exception(std::current_exception());
+    }
+}
+
+auto run_load_worker(detail::FontLoaderState &state, std::stop_token stop_token) -> void {
+    while (true) {
+        auto task = detail::FontLoadTask {};
+        {
+            auto lock = std::unique_lock {state.mutex};
+            if (!state.condition.wait(lock, stop_token,
+                                      [&] { return !state.queue.empty(); })) {
+                return;
+            }
+            // the wait returns queued tasks on stop, those are cancelled instead
+            if (stop_token.stop_requested()) {
+                return;
+            }
+            task = std::move(state.queue.front());
+            state.queue.pop_front();
+        }
+        run_load_task(task);
+    }
+}
+
+}  // namespace
+
+FontLoader::FontLoader(std::size_t thread_count)
+    : state_ {std::make_unique<detail::FontLoaderState>()} {
+    expects(thread_count > 0);
+
+    state_->workers.reserve(thread_count);
+    for (std::size_t i = 0; i < thread_count; ++i) {
+        state_->workers.emplace_back([state = state_.get()](std::stop_token stop_token) {
+            run_load_worker(*state, stop_token);
+        });
+    }
+}
+
+FontLoader::FontLoader(FontLoader &&) noexcept = default;
+
+auto FontLoader::operator=(FontLoader &&other) noexcept -> FontLoader & {
+    if (this != &other) {
+        // cancels the pending loads of this loader
+        const auto previous = std::move(*this);
+        state_ = std::move(other.state_);
+    }
+    return *this;
+}
+
+FontLoader::~FontLoader() {
+    if (state_ == nullptr) {
+        return;
+    }
+
+    // loads in progress finish, pending loads are cancelled
+    for (auto &worker : state_->workers) {
+        worker.request_stop();
+    }
+    state_->workers.clear();
+
+    for (auto &task : state_->queue) {
+        task.promise.set_exception(cancelled_load());
+    }
+}
+
+auto FontLoader::load(std::string filename, const FontLoadOptions &options,
+                      std::stop_token stop_token) -> std::future<FontFace> {
+    expects(state_ != nullptr);
+
+    auto task = detail::FontLoadTask {
+        .filename = std::move(filename),
+        .options = options,
+        .stop_token = std::move(stop_token),
     };
+    auto future = task.promise.get_future();
+
+    {
+        const auto lock = std::lock_guard {state_->mutex};
+        state_->queue.push_back(std::move(task));
+    }
+    state_->condition.notify_one();
+
+    return future;
+}
+
+auto FontLoader::pending() const -> std::size_t {
+    expects(state_ != nullptr);
+
+    const auto lock = std::lock_guard {state_->mutex};
+    return state_->queue.size();
 }
 
 }  // namespace blend2d_shaping
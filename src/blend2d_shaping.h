@@ -3,11 +3,22 @@
 
 #include <blend2d.h>
 
+#include <array>
 #include <cstdint>
+#include <fstream>
+#include <functional>
+#include <future>
+#include <limits>
+#include <list>
 #include <memory>
+#include <mutex>
+#include <optional>
 #include <span>
+#include <stop_token>
 #include <string>
 #include <string_view>
+#include <thread>
+#include <unordered_map>
 #include <vector>
 
 struct hb_face_t;
@@ -20,6 +31,8 @@ class HbFontFace final {
     explicit HbFontFace();
     explicit HbFontFace(std::span<const char> font_data, unsigned int font_index = 0);
     explicit HbFontFace(std::span<const uint8_t> font_data, unsigned int font_index = 0);
+    // shares the data of the array, e.g. with the BLFontData created from it
+    explicit HbFontFace(const BLArray<uint8_t> &font_data, unsigned int font_index = 0);
 
     [[nodiscard]] auto empty() const -> bool;
     [[nodiscard]] auto hb_face() const noexcept -> hb_face_t *;
@@ -38,46 +51,1028 @@ class HbFont final {
 
     [[nodiscard]] auto empty() const -> bool;
     [[nodiscard]] auto hb_font() const noexcept -> hb_font_t *;
+    [[nodiscard]] auto operator==(const HbFont &other) const -> bool = default;
 
    private:
     // immutable preserves whole parts relationship
     std::shared_ptr<hb_font_t> font_;
 };
 
-static_assert(std::semiregular<HbFont>);
+static_assert(std::regular<HbFont>);
 
+struct FontFace {
+    BLFontFace bl_face {};
+    HbFontFace hb_face {};
+    // advance of all glyphs in font units if the face is fixed-pitch, else zero
+    int32_t fixed_advance {};
+};
+
+struct Font {
+    BLFont bl_font {};
+    HbFont hb_font {};
+    // see FontFace::fixed_advance
+    int32_t fixed_advance {};
+};
+
+// engine that shapes a text run
+enum class ShapingBackend : uint8_t {
+    harfbuzz,
+    blend2d,
+};
+
+enum class ShapingBackendPolicy : uint8_t {
+    // Blend2D for simple Latin, Greek and Cyrillic text, HarfBuzz for everything
+    // else, long texts of a short repeated unit are tiled from a few shaped copies
+    automatic,
+    harfbuzz,
+    blend2d,
+    // shapes with both backends and throws if the results differ
+    parity_check,
+};
+
+enum class ShapingQuality : uint8_t {
+    // full OpenType shaping by the selected backend
+    full,
+    // nominal glyphs positioned by Blend2D with all GPOS lookups, like kerning
+    // and mark placement, but without glyph substitution
+    kerning_only,
+    // nominal glyphs and advances read directly from cmap and hmtx
+    nominal,
+    // nominal glyphs placed at the fixed advance of fixed-pitch fonts,
+    // falls back to nominal for other fonts or characters
+    monospace,
+};
+
+struct FontFeature {
+    BLTag tag {};
+    uint32_t value {1};
+
+    [[nodiscard]] auto operator==(const FontFeature &other) const -> bool = default;
+};
+
+struct ShapingOptions {
+    ShapingBackendPolicy backend_policy {ShapingBackendPolicy::automatic};
+    // lighter qualities bypass the backend policy
+    ShapingQuality quality {ShapingQuality::full};
+    // applied to the whole text, only HarfBuzz applies features, so texts with
+    // features are fully shaped by HarfBuzz regardless of policy and quality
+    std::vector<FontFeature> features {};
+
+    [[nodiscard]] auto operator==(const ShapingOptions &other) const -> bool = default;
+};
+
+namespace detail {
+struct ShapedGlyphs;
+struct ShaperState;
+struct MappedFile;
+struct FontLoaderState;
+}  // namespace detail
+
+struct ShapedTextDiff;
+
+// style of the byte range [byte_begin, byte_end) of a text, e.g. a color index
+struct StyleRun {
+    std::size_t byte_begin {};
+    std::size_t byte_end {};
+    uint32_t style {};
+
+    [[nodiscard]] auto operator==(const StyleRun &) const -> bool = default;
+};
+
+struct StyledGlyphRun {
+    uint32_t style {};
+    // pen position of the first glyph relative to the text origin
+    BLPoint origin {};
+    // references the glyphs of the shaped text
+    BLGlyphRun glyph_run {};
+};
+
+/**
+ * @brief Glyphs of a shaped text.
+ *
+ * Neither the source text nor the font are retained, so constructing and
+ * copying it allocates only the glyph arrays. See EditableShapedText to
+ * append and slice shaped text.
+ */
 class HbShapedText {
    public:
     explicit HbShapedText() = default;
     explicit HbShapedText(std::string_view text_utf8, const HbFont &font,
                           float font_size);
+    explicit HbShapedText(std::string_view text_utf8, const Font &font,
+                          const ShapingOptions &options = {});
 
     [[nodiscard]] auto empty() const -> bool;
-    [[nodiscard]] auto operator==(const HbShapedText &other) const -> bool = default;
+    // equal if glyphs and bounds match, independent of how it was shaped
+    [[nodiscard]] auto operator==(const HbShapedText &other) const -> bool;
 
+    // bytes of the text the clusters refer to
+    [[nodiscard]] auto text_size() const noexcept -> std::size_t;
+    [[nodiscard]] auto font_size() const noexcept -> float;
     // glyph run of the shaped text
     [[nodiscard]] auto glyph_run() const noexcept -> BLGlyphRun;
+    // byte offset into the text of the cluster of each glyph
+    [[nodiscard]] auto clusters() const noexcept -> std::span<const uint32_t>;
+    /**
+     * @brief Splits the glyph run by sorted, non-overlapping style runs.
+     *
+     * Glyphs are assigned the style of their cluster, so all slices render
+     * from one shaping pass with kerning intact across style boundaries.
+     * Glyphs outside of all runs get the default style.
+     */
+    [[nodiscard]] auto styled_glyph_runs(std::span<const StyleRun> style_runs,
+                                         uint32_t default_style = 0) const
+        -> std::vector<StyledGlyphRun>;
+    // pen advance of the whole text scaled to the font size
+    [[nodiscard]] auto advance() const -> BLPoint;
     // bounding box of the shaped text relative to the baseline
     [[nodiscard]] auto bounding_box() const noexcept -> BLBox;
     // rect of the shaped text relative to the baseline
     [[nodiscard]] auto bounding_rect() const noexcept -> BLRect;
 
+    // true if the text can be split at the byte offset without reshaping, also
+    // for right-to-left text, whose clusters descend. Blend2D and kerning-only
+    // results have no glyph flags unless edited, then only the ends are safe.
+    [[nodiscard]] auto is_safe_to_break(std::size_t byte_offset) const -> bool;
+
+    // bytes of the object and its heap allocations, including unused capacity
+    [[nodiscard]] auto memory_usage() const -> std::size_t;
+
    private:
+    friend class EditableShapedText;
+    friend class NumericTextShaper;
+    friend class ShapedTextTemplate;
+    friend auto diff(const HbShapedText &previous, const HbShapedText &next,
+                     const HbFont &font) -> ShapedTextDiff;
+
+    // from already shaped glyphs, computes the bounding box
+    explicit HbShapedText(std::size_t text_size, const HbFont &font, float font_size,
+                          detail::ShapedGlyphs &&glyphs);
+
+    // appends the glyphs of other, both texts need the same font and options,
+    // reshapes only the clusters around the seam
+    auto splice(std::string_view text_utf8, const HbShapedText &other,
+                std::string_view other_utf8, const Font &font,
+                const ShapingOptions &options) -> void;
+    // glyphs of the byte range, which needs to be safe to break at both ends
+    [[nodiscard]] auto slice_glyphs(std::size_t byte_begin, std::size_t byte_end,
+                                    const HbFont &font) const -> HbShapedText;
+
+    [[nodiscard]] auto has_glyph_flags() const noexcept -> bool;
+    // derives the flags Blend2D doesn't report, needed before splicing or slicing
+    auto ensure_glyph_flags(std::string_view text_utf8, const HbFont &font) -> void;
+
     std::vector<uint32_t> codepoints_ {};
     std::vector<BLGlyphPlacement> placements_ {};
+    std::vector<uint32_t> clusters_ {};
+    // hb_glyph_flags_t of each glyph, empty until derived for Blend2D results
+    std::vector<uint8_t> glyph_flags_ {};
     BLBox bounding_box_ {};
+    // pixels per font unit, so measuring doesn't need the font
+    BLPoint scale_ {};
+    float font_size_ {};
+    std::size_t text_size_ {};
 };
 
 static_assert(std::regular<HbShapedText>);
 
-struct FontFace {
-    BLFontFace bl_face {};
-    HbFontFace hb_face {};
+/**
+ * @brief Shaped text with its source text, font and options, for editing.
+ *
+ * Appending and slicing reuse the shaped glyphs and reshape only the clusters
+ * around a seam or an unsafe cut, as described for HB_GLYPH_FLAG_UNSAFE_TO_CONCAT.
+ * Blend2D reports no glyph flags, they are derived from substituted and
+ * repositioned glyphs. Where those make a seam unsafe, the text before it is
+ * reshaped whole. Glyphs of right-to-left text are in visual order, so it is
+ * reshaped whole too. The results are the glyphs of shaping the whole text.
+ */
+class EditableShapedText {
+   public:
+    explicit EditableShapedText(std::string_view text_utf8, const Font &font,
+                                const ShapingOptions &options = {});
+
+    [[nodiscard]] auto text_utf8() const noexcept -> std::string_view;
+    [[nodiscard]] auto font() const noexcept -> const Font &;
+    [[nodiscard]] auto options() const noexcept -> const ShapingOptions &;
+    [[nodiscard]] auto shaped() const noexcept -> const HbShapedText &;
+
+    // appends text shaped with the same font and options, which is a precondition
+    auto append(const EditableShapedText &other) -> void;
+    // shapes the text the same way as this one and appends it
+    auto append(std::string_view text_utf8) -> void;
+
+    // the byte range of the text, reshaped only if a boundary is unsafe to break
+    [[nodiscard]] auto slice(std::size_t byte_begin, std::size_t byte_end) const
+        -> EditableShapedText;
+
+    // bytes of the object and its heap allocations, including unused capacity
+    [[nodiscard]] auto memory_usage() const -> std::size_t;
+
+   private:
+    explicit EditableShapedText(std::string_view text_utf8, const Font &font,
+                                const ShapingOptions &options, HbShapedText &&shaped);
+
+    std::string text_utf8_ {};
+    Font font_ {};
+    ShapingOptions options_ {};
+    HbShapedText shaped_ {};
 };
 
-struct Font {
-    BLFont bl_font {};
-    HbFont hb_font {};
+// joins two shaped texts, see EditableShapedText::append
+[[nodiscard]] auto concat(const EditableShapedText &first,
+                          const EditableShapedText &second) -> EditableShapedText;
+
+// bounding box of the glyph run relative to the baseline, e.g. of a slice
+[[nodiscard]] auto calculate_bounding_box(const BLGlyphRun &glyph_run, const HbFont &font,
+                                          float font_size) -> BLBox;
+
+// glyph indices [begin, end)
+struct GlyphRange {
+    std::size_t begin {};
+    std::size_t end {};
+
+    [[nodiscard]] auto operator==(const GlyphRange &) const -> bool = default;
+};
+
+struct ShapedTextDiff {
+    // glyphs of the previous text that are no longer drawn
+    std::vector<GlyphRange> removed {};
+    // glyphs of the next text that are newly drawn
+    std::vector<GlyphRange> added {};
+    // ink of all removed and added glyphs relative to the baseline
+    BLBox dirty_box {};
+
+    [[nodiscard]] auto empty() const -> bool;
+};
+
+/**
+ * @brief Finds the glyphs that differ between two texts drawn at the same origin.
+ *
+ * Glyphs with the same id, placement and pen position are unchanged, so only
+ * the dirty box needs to be repainted. Both texts are shaped with the face,
+ * texts of a different size are entirely changed.
+ */
+[[nodiscard]] auto diff(const HbShapedText &previous, const HbShapedText &next,
+                        const HbFont &font) -> ShapedTextDiff;
+
+/**
+ * @brief Repeats the unit, like a leader dot, as often as it fits into the width.
+ *
+ * With the automatic policy, text made of a short repeated unit is shaped
+ * from a few copies and tiled, so shaping cost does not grow with the width.
+ */
+[[nodiscard]] auto fill_to_width(std::string_view unit_utf8, const Font &font,
+                                 double width, const ShapingOptions &options = {})
+    -> HbShapedText;
+
+// backend the automatic policy chooses for the text
+[[nodiscard]] auto select_shaping_backend(std::string_view text_utf8,
+                                          const ShapingOptions &options = {})
+    -> ShapingBackend;
+
+struct ShapingParity {
+    HbShapedText harfbuzz {};
+    HbShapedText blend2d {};
+
+    [[nodiscard]] auto equal() const -> bool;
+};
+
+// shapes the text with both backends for comparison
+[[nodiscard]] auto check_shaping_parity(std::string_view text_utf8, const Font &font,
+                                        const ShapingOptions &options = {})
+    -> ShapingParity;
+
+/**
+ * @brief Shapes numeric text like "12.34 ms" from glyphs pre-shaped per font.
+ *
+ * Digits, sign, separators and the registered unit suffixes are shaped once,
+ * together with every pair of them to capture pair kerning. Contextual
+ * positioning over more glyphs isn't captured, so a sample of numbers is
+ * compared with HbShapedText {text, font, options()} at construction, and if
+ * any differs, all text is shaped. Text with other characters, or pairs that
+ * substitute glyphs, falls back to shaping too.
+ */
+class NumericTextShaper {
+   public:
+    explicit NumericTextShaper() = default;
+    explicit NumericTextShaper(const Font &font,
+                               std::span<const std::string_view> suffixes = {},
+                               bool tabular_figures = true);
+
+    [[nodiscard]] auto options() const noexcept -> const ShapingOptions &;
+    // true if the text is assembled without shaping
+    [[nodiscard]] auto is_pre_shaped(std::string_view text_utf8) const -> bool;
+
+    [[nodiscard]] auto shape(std::string_view text_utf8) const -> HbShapedText;
+    // formats the value in fixed notation with the given suffix and shapes it
+    [[nodiscard]] auto format(double value, int precision,
+                              std::string_view suffix = {}) const -> HbShapedText;
+
+   private:
+    struct PairAdjustment {
+        // advance and offset change of the left glyph
+        BLGlyphPlacement delta {};
+        bool pre_shaped {false};
+    };
+
+    struct Suffix {
+        std::string text_utf8 {};
+        HbShapedText shaped {};
+        // indexed by the character before the suffix
+        std::vector<PairAdjustment> pairs {};
+    };
+
+    [[nodiscard]] auto find_suffix(std::string_view text_utf8) const -> const Suffix *;
+
+    Font font_ {};
+    ShapingOptions options_ {};
+
+    // glyph table index plus one per ASCII character, zero if not numeric
+    std::array<uint8_t, 128> char_index_ {};
+    std::vector<uint32_t> codepoints_ {};
+    std::vector<BLGlyphPlacement> placements_ {};
+    std::vector<uint8_t> glyph_flags_ {};
+    // indexed by left * character count + right
+    std::vector<PairAdjustment> pairs_ {};
+    std::vector<Suffix> suffixes_ {};
+    // false if the face positions the sample differently, then all text is shaped
+    bool verified_ {false};
+};
+
+struct AttributedRun {
+    std::size_t byte_begin {};
+    std::size_t byte_end {};
+    // also determines the size, create one font per size
+    Font font {};
+    std::vector<FontFeature> features {};
+};
+
+/**
+ * @brief Rich text with a font and features per byte range, shaped in one call.
+ *
+ * All runs are shaped by HarfBuzz through one buffer, with the surrounding text
+ * as context, and their glyphs are stored contiguously. Runs must be ordered
+ * and must not overlap, text outside of all runs is not shaped.
+ */
+class AttributedText {
+   public:
+    explicit AttributedText() = default;
+    explicit AttributedText(std::string_view text_utf8,
+                            std::span<const AttributedRun> runs);
+
+    [[nodiscard]] auto empty() const -> bool;
+    [[nodiscard]] auto text_utf8() const noexcept -> std::string_view;
+
+    [[nodiscard]] auto run_count() const noexcept -> std::size_t;
+    // font to render the glyph run of the run with
+    [[nodiscard]] auto font(std::size_t run) const -> const Font &;
+    // pen position of the first glyph of the run relative to the text origin
+    [[nodiscard]] auto origin(std::size_t run) const -> BLPoint;
+    // references the glyphs of the run
+    [[nodiscard]] auto glyph_run(std::size_t run) const -> BLGlyphRun;
+
+    // byte offset into the whole text of the cluster of each glyph
+    [[nodiscard]] auto clusters() const noexcept -> std::span<const uint32_t>;
+    // pen advance of all runs scaled to their font sizes
+    [[nodiscard]] auto advance() const noexcept -> BLPoint;
+    // bounding box of all runs relative to the baseline
+    [[nodiscard]] auto bounding_box() const noexcept -> BLBox;
+    [[nodiscard]] auto bounding_rect() const noexcept -> BLRect;
+
+   private:
+    struct Run {
+        Font font {};
+        std::size_t glyph_begin {};
+        std::size_t glyph_end {};
+        BLPoint origin {};
+    };
+
+    std::string text_utf8_ {};
+    std::vector<Run> runs_ {};
+
+    // glyphs of all runs
+    std::vector<uint32_t> codepoints_ {};
+    std::vector<BLGlyphPlacement> placements_ {};
+    std::vector<uint32_t> clusters_ {};
+    BLPoint advance_ {};
+    BLBox bounding_box_ {};
+};
+
+static_assert(std::semiregular<AttributedText>);
+
+/**
+ * @brief Label pattern like "CPU {0}% - {1} threads" with pre-shaped static text.
+ *
+ * Fields are referenced by index, literal braces are written as "{{" and "}}".
+ * Instances shape only the fields and splice them between the static segments.
+ * Clusters next to a splice point that is unsafe to concatenate are reshaped,
+ * see EditableShapedText.
+ */
+class ShapedTextTemplate {
+   public:
+    explicit ShapedTextTemplate() = default;
+    explicit ShapedTextTemplate(std::string_view pattern_utf8, const Font &font,
+                                const ShapingOptions &options = {});
+
+    // number of fields an instance needs, one more than the highest index
+    [[nodiscard]] auto field_count() const noexcept -> std::size_t;
+    [[nodiscard]] auto instantiate(std::span<const std::string_view> fields) const
+        -> HbShapedText;
+
+   private:
+    auto add_segment(std::string_view text_utf8) -> void;
+
+    Font font_ {};
+    ShapingOptions options_ {};
+
+    struct Segment {
+        std::string text_utf8 {};
+        HbShapedText shaped {};
+    };
+
+    // static text before each field and after the last one
+    std::vector<Segment> segments_ {};
+    std::vector<std::size_t> field_indices_ {};
+    std::size_t field_count_ {};
+};
+
+/**
+ * @brief Least recently used cache of texts shaped with one font and options.
+ *
+ * Not thread-safe, use one cache per thread.
+ */
+class ShapedTextCache {
+   public:
+    explicit ShapedTextCache() = default;
+    explicit ShapedTextCache(const Font &font, std::size_t capacity,
+                             const ShapingOptions &options = {});
+
+    // the index refers to the entries, which stay in place only when moved
+    ShapedTextCache(const ShapedTextCache &) = delete;
+    ShapedTextCache(ShapedTextCache &&) = default;
+    auto operator=(const ShapedTextCache &) -> ShapedTextCache & = delete;
+    auto operator=(ShapedTextCache &&) -> ShapedTextCache & = default;
+    ~ShapedTextCache() = default;
+
+    // shapes the text on a miss, valid until the next call
+    [[nodiscard]] auto get(std::string_view text_utf8) -> const HbShapedText &;
+
+    [[nodiscard]] auto size() const noexcept -> std::size_t;
+    [[nodiscard]] auto capacity() const noexcept -> std::size_t;
+    [[nodiscard]] auto hits() const noexcept -> uint64_t;
+    [[nodiscard]] auto misses() const noexcept -> uint64_t;
+
+    auto clear() -> void;
+
+    // bytes of the cache and its entries, container nodes are estimated
+    [[nodiscard]] auto memory_usage() const -> std::size_t;
+
+   private:
+    Font font_ {};
+    ShapingOptions options_ {};
+    std::size_t capacity_ {};
+
+    struct Entry {
+        std::string text_utf8 {};
+        HbShapedText shaped {};
+    };
+
+    // most recently used first
+    std::list<Entry> entries_ {};
+    std::unordered_map<std::string_view, std::list<Entry>::iterator> index_ {};
+
+    uint64_t hits_ {};
+    uint64_t misses_ {};
+};
+
+// glyphs of the last text shaped into it, storage is kept for the next one
+class ShapedTextBuffer {
+   public:
+    [[nodiscard]] auto empty() const -> bool;
+    [[nodiscard]] auto glyph_run() const noexcept -> BLGlyphRun;
+    [[nodiscard]] auto clusters() const noexcept -> std::span<const uint32_t>;
+    [[nodiscard]] auto advance() const noexcept -> BLPoint;
+    [[nodiscard]] auto bounding_box() const noexcept -> BLBox;
+
+    auto reserve(std::size_t glyph_count) -> void;
+    auto clear() -> void;
+
+   private:
+    friend class Shaper;
+    friend class CompactShapedText;
+
+    std::vector<uint32_t> codepoints_ {};
+    std::vector<BLGlyphPlacement> placements_ {};
+    std::vector<uint32_t> clusters_ {};
+    BLPoint advance_ {};
+    BLBox bounding_box_ {};
+};
+
+/**
+ * @brief Shapes with HarfBuzz into caller-provided storage.
+ *
+ * The HarfBuzz buffer and features are kept between calls. Once texts up to
+ * a length have been shaped, the buffer, the cached shape plan and the output
+ * storage have enough capacity, and shaping performs no heap allocations.
+ * Not thread-safe, use one shaper per thread.
+ */
+class Shaper {
+   public:
+    explicit Shaper();
+    explicit Shaper(const Font &font, std::span<const FontFeature> features = {});
+
+    Shaper(const Shaper &) = delete;
+    Shaper(Shaper &&) noexcept;
+    auto operator=(const Shaper &) -> Shaper & = delete;
+    auto operator=(Shaper &&) noexcept -> Shaper &;
+    ~Shaper();
+
+    auto shape(std::string_view text_utf8, ShapedTextBuffer &output) -> void;
+
+   private:
+    Font font_ {};
+    std::unique_ptr<detail::ShaperState> state_ {};
+};
+
+// shaped glyphs owned by a TextArena or ShapedTextFile
+struct ShapedTextView {
+    BLGlyphRun glyph_run {};
+    std::span<const uint32_t> clusters {};
+    BLPoint advance {};
+    BLBox bounding_box {};
+};
+
+/**
+ * @brief Frame-scoped storage for transient shaped text.
+ *
+ * Glyphs, placements and clusters are bump allocated in blocks, and reset
+ * releases all texts at once in O(1). Views are valid until the next reset.
+ * Blocks and the HarfBuzz buffer are kept, so once a frame's worth of text has
+ * been shaped, later frames don't allocate. Not thread-safe, use one arena per
+ * thread.
+ */
+class TextArena {
+   public:
+    explicit TextArena(std::size_t block_glyph_capacity = 4096);
+
+    TextArena(const TextArena &) = delete;
+    TextArena(TextArena &&) noexcept;
+    auto operator=(const TextArena &) -> TextArena & = delete;
+    auto operator=(TextArena &&) noexcept -> TextArena &;
+    ~TextArena();
+
+    [[nodiscard]] auto shape(std::string_view text_utf8, const Font &font,
+                             std::span<const FontFeature> features = {})
+        -> ShapedTextView;
+    auto reset() noexcept -> void;
+
+    // glyphs shaped since the last reset
+    [[nodiscard]] auto glyph_count() const noexcept -> std::size_t;
+    // bytes of blocks and buffers, including unused capacity
+    [[nodiscard]] auto memory_usage() const -> std::size_t;
+
+   private:
+    struct Block {
+        std::unique_ptr<uint32_t[]> codepoints {};
+        std::unique_ptr<BLGlyphPlacement[]> placements {};
+        std::unique_ptr<uint32_t[]> clusters {};
+        std::size_t capacity {};
+        std::size_t used {};
+    };
+
+    auto allocate(std::size_t glyph_count) -> Block &;
+
+    std::size_t block_glyph_capacity_ {};
+    std::unique_ptr<detail::ShaperState> state_ {};
+    std::vector<Block> blocks_ {};
+    std::size_t block_index_ {};
+    std::size_t glyph_count_ {};
+};
+
+/**
+ * @brief Shaped text in a compact encoding for retained storage.
+ *
+ * Glyph ids use 16 bits when all fit, and only the x-advance is stored per
+ * glyph. Glyphs with offsets, y-advances or larger advances are stored
+ * sparsely with their full placement. For horizontal text this needs about
+ * 4 bytes per glyph instead of 20. Expand into a buffer to draw it.
+ */
+class CompactShapedText {
+   public:
+    explicit CompactShapedText() = default;
+    explicit CompactShapedText(const HbShapedText &text);
+    explicit CompactShapedText(const BLGlyphRun &glyph_run, const BLBox &bounding_box,
+                               const BLPoint &advance);
+
+    [[nodiscard]] auto empty() const -> bool;
+    [[nodiscard]] auto size() const -> std::size_t;
+    [[nodiscard]] auto bounding_box() const noexcept -> BLBox;
+    [[nodiscard]] auto advance() const noexcept -> BLPoint;
+
+    // writes glyphs and placements into the buffer, without clusters
+    auto expand(ShapedTextBuffer &output) const -> void;
+
+    // heap and object bytes, including unused capacity
+    [[nodiscard]] auto memory_usage() const -> std::size_t;
+
+   private:
+    struct SparsePlacement {
+        uint32_t index {};
+        BLGlyphPlacement placement {};
+    };
+
+    // only one of them is used
+    std::vector<uint16_t> glyph_ids_ {};
+    std::vector<uint32_t> wide_glyph_ids_ {};
+
+    std::vector<int16_t> x_advances_ {};
+    // sorted by index
+    std::vector<SparsePlacement> sparse_placements_ {};
+    BLBox bounding_box_ {};
+    BLPoint advance_ {};
+};
+
+// identifies a text in a ShapedTextStore, stays valid across compaction
+struct ShapedTextHandle {
+    uint32_t index {};
+
+    [[nodiscard]] auto operator==(const ShapedTextHandle &) const -> bool = default;
+};
+
+/**
+ * @brief Columnar storage for many retained shaped texts.
+ *
+ * Glyphs and placements of all texts share two arrays. Per text only the glyph
+ * offset and count and the bounding box, rounded outwards to whole pixels in
+ * 16 bits, are stored, 16 bytes in total. Erased texts leave gaps until
+ * compact is called, their handles are reused by later appends.
+ */
+class ShapedTextStore {
+   public:
+    explicit ShapedTextStore() = default;
+
+    auto append(const HbShapedText &text) -> ShapedTextHandle;
+    auto append(const BLGlyphRun &glyph_run, const BLBox &bounding_box)
+        -> ShapedTextHandle;
+    auto erase(ShapedTextHandle handle) -> void;
+    // removes the gaps of erased texts and releases unused capacity
+    auto compact() -> void;
+    auto clear() -> void;
+
+    [[nodiscard]] auto contains(ShapedTextHandle handle) const -> bool;
+    [[nodiscard]] auto glyph_run(ShapedTextHandle handle) const -> BLGlyphRun;
+    // contains the appended box, clamped to the 16-bit range
+    [[nodiscard]] auto bounding_box(ShapedTextHandle handle) const -> BLBox;
+
+    // one past the largest handle index, for iterating over all texts
+    [[nodiscard]] auto handle_count() const noexcept -> std::size_t;
+    [[nodiscard]] auto size() const noexcept -> std::size_t;
+    [[nodiscard]] auto glyph_count() const noexcept -> std::size_t;
+    // glyphs of erased texts, freed by compact
+    [[nodiscard]] auto erased_glyph_count() const noexcept -> std::size_t;
+    [[nodiscard]] auto memory_usage() const -> std::size_t;
+
+   private:
+    struct Entry {
+        uint32_t offset {};
+        uint32_t count {};
+        // whole pixels
+        int16_t x0 {};
+        int16_t y0 {};
+        int16_t x1 {};
+        int16_t y1 {};
+    };
+
+    // offset of erased texts
+    static constexpr auto erased_offset = std::numeric_limits<uint32_t>::max();
+
+    std::vector<uint32_t> codepoints_ {};
+    std::vector<BLGlyphPlacement> placements_ {};
+
+    // indexed by handle
+    std::vector<Entry> entries_ {};
+
+    std::vector<uint32_t> free_handles_ {};
+    std::size_t erased_glyph_count_ {};
+};
+
+// identifies the face by its data, e.g. to validate files of shaped text,
+// computed once per face
+[[nodiscard]] auto content_hash(const HbFontFace &face) -> uint64_t;
+
+/**
+ * @brief Writes shaped texts to a file that ShapedTextFile maps.
+ *
+ * The file is keyed by the content hash of the face, the font size and the
+ * options of the texts, so at least one text is needed, and all need the
+ * same face, size and options. Byte order is native. Throws
+ * std::runtime_error if the file can't be written.
+ */
+auto write_shaped_text_file(const char *filename,
+                            std::span<const EditableShapedText> texts) -> void;
+
+/**
+ * @brief Memory mapped file of shaped texts, written by write_shaped_text_file.
+ *
+ * Lookups return views into the mapping without deserializing. Files that are
+ * missing, damaged, of another version or for a different face, size or
+ * options are stale, and all their lookups miss. find_or_shape shapes misses
+ * with the font and options of the file into a ShapedTextCache, so stale files
+ * still return every text.
+ */
+class ShapedTextFile {
+   public:
+    explicit ShapedTextFile();
+    // the capacity is the one of the cache for texts that miss
+    explicit ShapedTextFile(const char *filename, const Font &font,
+                            const ShapingOptions &options = {},
+                            std::size_t miss_capacity = 256);
+
+    ShapedTextFile(const ShapedTextFile &) = delete;
+    ShapedTextFile(ShapedTextFile &&) noexcept;
+    auto operator=(const ShapedTextFile &) -> ShapedTextFile & = delete;
+    auto operator=(ShapedTextFile &&) noexcept -> ShapedTextFile &;
+    ~ShapedTextFile();
+
+    [[nodiscard]] auto stale() const noexcept -> bool;
+    [[nodiscard]] auto size() const noexcept -> std::size_t;
+    [[nodiscard]] auto find(std::string_view text_utf8) const
+        -> std::optional<ShapedTextView>;
+    // views of texts that missed are valid until the next call
+    [[nodiscard]] auto find_or_shape(std::string_view text_utf8) -> ShapedTextView;
+    // calls of find_or_shape that missed the file
+    [[nodiscard]] auto misses() const noexcept -> uint64_t;
+
+   private:
+    std::unique_ptr<detail::MappedFile> file_;
+    ShapedTextCache missed_ {};
+};
+
+// coverage mask of a glyph in a GlyphAtlas
+struct AtlasGlyph {
+    // area in the atlas image, empty for glyphs without ink
+    BLRectI rect {};
+    // from the pen position to the top-left corner of the area, in pixels
+    BLPointI offset {};
+};
+
+/**
+ * @brief Atlas of rasterized glyph coverage masks in an A8 image.
+ *
+ * Glyphs are keyed by the content hash of their face, font size, subpixel bin
+ * and glyph id, and rasterized on first use. Snapshots saved to a file are
+ * loaded on startup, so warm starts don't rasterize again. The file is mapped,
+ * but its pixels are copied into the atlas image, which stays writable for new
+ * glyphs. Entries of faces whose data changed have different keys and are
+ * never found.
+ */
+class GlyphAtlas {
+   public:
+    // horizontal pen positions are rounded to a quarter pixel
+    static constexpr auto subpixel_bins = uint32_t {4};
+
+    explicit GlyphAtlas(int width = 1024, int height = 1024);
+
+    // rasterizes the glyph if needed, nullopt if the atlas is full
+    [[nodiscard]] auto glyph(const Font &font, uint32_t glyph_id,
+                             uint32_t subpixel_bin = 0) -> std::optional<AtlasGlyph>;
+
+    [[nodiscard]] auto image() const noexcept -> const BLImage &;
+    [[nodiscard]] auto size() const noexcept -> std::size_t;
+    // glyphs rasterized since construction, clear or load
+    [[nodiscard]] auto rasterized_count() const noexcept -> std::size_t;
+    auto clear() -> void;
+
+    // throws std::runtime_error if the file can't be written
+    auto save(const char *filename) const -> void;
+    // replaces the content, false if the file is missing, damaged or of another
+    // version or atlas size
+    auto load(const char *filename) -> bool;
+
+   private:
+    struct Key {
+        uint64_t face_hash {};
+        float font_size {};
+        uint32_t glyph_id {};
+        uint32_t subpixel_bin {};
+
+        [[nodiscard]] auto operator==(const Key &) const -> bool = default;
+    };
+
+    struct KeyHash {
+        [[nodiscard]] auto operator()(const Key &key) const noexcept -> std::size_t;
+    };
+
+    [[nodiscard]] auto allocate(int width, int height) -> std::optional<BLRectI>;
+
+    BLImage image_ {};
+    std::unordered_map<Key, AtlasGlyph, KeyHash> glyphs_ {};
+    std::size_t rasterized_count_ {};
+
+    // shelf packing, rows of glyphs from top to bottom
+    int shelf_x_ {};
+    int shelf_y_ {};
+    int shelf_height_ {};
+};
+
+// text that was hot during a session, see WarmupProfile
+struct WarmupEntry {
+    std::string text_utf8 {};
+    // see content_hash
+    uint64_t face_hash {};
+    float font_size {};
+    ShapingOptions options {};
+    // lower values are warmed first, e.g. zero for visible UI
+    uint32_t priority {};
+    // recorded uses
+    uint32_t count {};
+};
+
+/**
+ * @brief Records which texts were shaped during a session.
+ *
+ * Save the profile on exit and pass its entries to start_warmup on the next
+ * start. Recording is thread-safe, but takes a lock and builds a key per call.
+ */
+class WarmupProfile {
+   public:
+    explicit WarmupProfile() = default;
+
+    auto record(std::string_view text_utf8, const Font &font,
+                const ShapingOptions &options = {}, uint32_t priority = 0) -> void;
+
+    // by priority, most used first within a priority
+    [[nodiscard]] auto entries(
+        std::size_t max_count = std::numeric_limits<std::size_t>::max()) const
+        -> std::vector<WarmupEntry>;
+    [[nodiscard]] auto size() const -> std::size_t;
+    auto clear() -> void;
+
+    // keeps the first entries, throws std::runtime_error if the file can't be written
+    auto save(const char *filename, std::size_t max_count = 1024) const -> void;
+    // merges the entries, false if the file is missing or damaged
+    auto load(const char *filename) -> bool;
+
+   private:
+    auto add(WarmupEntry entry) -> void;
+
+    mutable std::mutex mutex_ {};
+    std::unordered_map<std::string, WarmupEntry> entries_ {};
+};
+
+// called on the warmup thread for each shaped entry
+using WarmupCallback = std::function<void(const WarmupEntry &, HbShapedText &&)>;
+
+/**
+ * @brief Shapes the entries in order on a background thread.
+ *
+ * This compiles the shape plans and fills the glyph caches of the fonts, and
+ * hands each shaped text to the callback, e.g. to fill caches. Entries without
+ * a font of the same face and size, or that fail to shape, are skipped.
+ * Request a stop or destroy the thread to cancel.
+ */
+[[nodiscard]] auto start_warmup(std::vector<WarmupEntry> entries, std::vector<Font> fonts,
+                                WarmupCallback on_shaped = {}) -> std::jthread;
+
+/**
+ * @brief Font data held by a face.
+ *
+ * Faces created from files share one buffer of the font file between Blend2D
+ * and HarfBuzz, which is counted once. Parsed tables and shaping caches of
+ * either library are not exposed, so they are not included.
+ */
+struct FaceMemoryUsage {
+    // font file read by HarfBuzz
+    std::size_t hb_font_data {};
+    // tables held by Blend2D outside of that buffer
+    std::size_t bl_font_data {};
+
+    [[nodiscard]] auto total() const noexcept -> std::size_t;
+};
+
+[[nodiscard]] auto memory_usage(const FontFace &face) -> FaceMemoryUsage;
+
+// sums the memory of text objects, faces shared by copies are counted once,
+// the report keeps the added faces alive
+class MemoryReport {
+   public:
+    auto add(const FontFace &face) -> void;
+    auto add(const HbShapedText &text) -> void;
+    auto add(const ShapedTextStore &store) -> void;
+    auto add(const CompactShapedText &text) -> void;
+    auto add(const ShapedTextCache &cache) -> void;
+
+    [[nodiscard]] auto face_bytes() const noexcept -> std::size_t;
+    [[nodiscard]] auto shaped_text_bytes() const noexcept -> std::size_t;
+    [[nodiscard]] auto cache_bytes() const noexcept -> std::size_t;
+    [[nodiscard]] auto total_bytes() const noexcept -> std::size_t;
+
+   private:
+    // references to the counted faces
+    std::vector<HbFontFace> faces_ {};
+    std::size_t face_bytes_ {};
+    std::size_t shaped_text_bytes_ {};
+    std::size_t cache_bytes_ {};
+};
+
+// stages timed if built with BLEND2D_SHAPING_INSTRUMENTATION
+enum class ShapingStage : uint8_t {
+    buffer_setup,
+    // hb_shape or BLFont shaping
+    shape,
+    glyph_extraction,
+    bounds,
+    font_creation,
+    face_creation,
+};
+
+constexpr auto shaping_stage_count = std::size_t {6};
+constexpr auto latency_bucket_count = std::size_t {32};
+
+struct StageStatistics {
+    uint64_t count {};
+    uint64_t total_ns {};
+    // bucket i counts latencies in [2^i, 2^(i+1)) nanoseconds, the first includes 0
+    std::array<uint64_t, latency_bucket_count> histogram {};
+};
+
+struct InstrumentationSnapshot {
+    std::array<StageStatistics, shaping_stage_count> stages {};
+    uint64_t shaped_texts {};
+    uint64_t glyphs {};
+
+    [[nodiscard]] auto stage(ShapingStage stage) const -> const StageStatistics &;
+};
+
+[[nodiscard]] auto instrumentation_enabled() noexcept -> bool;
+// sums the per-thread counters, empty if instrumentation is compiled out
+[[nodiscard]] auto instrumentation_snapshot() -> InstrumentationSnapshot;
+
+// span of a traced operation, names and categories are static strings
+struct TraceEvent {
+    const char *name {};
+    const char *category {};
+    uint64_t thread_id {};
+    int64_t start_ns {};
+    int64_t duration_ns {};
+};
+
+class TraceSink {
+   public:
+    virtual ~TraceSink() = default;
+
+    // receives the buffered events of the calling thread
+    virtual auto write(std::span<const TraceEvent> events) -> void = 0;
+};
+
+/**
+ * @brief Sends trace spans of all threads to the sink, nullptr stops tracing.
+ *
+ * Spans are recorded if built with BLEND2D_SHAPING_TRACING. Each thread
+ * buffers its events and hands them to the current sink when the buffer is
+ * full, on flush_trace_events() and at thread exit. Events that other threads
+ * buffered before the sink changes are discarded, call flush_trace_events() on
+ * those threads first to keep them.
+ */
+auto set_trace_sink(std::shared_ptr<TraceSink> sink) -> void;
+// hands the buffered events of the calling thread to the sink
+auto flush_trace_events() -> void;
+
+// records the lifetime of the span if tracing is active, e.g. for batch jobs
+class TraceSpan {
+   public:
+    explicit TraceSpan(const char *name, const char *category = "blend2d_shaping");
+    ~TraceSpan();
+
+    TraceSpan(const TraceSpan &) = delete;
+    TraceSpan(TraceSpan &&) = delete;
+    auto operator=(const TraceSpan &) -> TraceSpan & = delete;
+    auto operator=(TraceSpan &&) -> TraceSpan & = delete;
+
+   private:
+    const char *name_ {};
+    const char *category_ {};
+    // negative if not recorded
+    int64_t start_ns_ {-1};
+};
+
+// writes Chrome trace-event JSON, as read by chrome://tracing and Perfetto
+class ChromeTraceWriter final : public TraceSink {
+   public:
+    explicit ChromeTraceWriter(const std::string &filename);
+    ~ChromeTraceWriter() override;
+
+    ChromeTraceWriter(const ChromeTraceWriter &) = delete;
+    ChromeTraceWriter(ChromeTraceWriter &&) = delete;
+    auto operator=(const ChromeTraceWriter &) -> ChromeTraceWriter & = delete;
+    auto operator=(ChromeTraceWriter &&) -> ChromeTraceWriter & = delete;
+
+    auto write(std::span<const TraceEvent> events) -> void override;
+
+   private:
+    std::mutex mutex_ {};
+    std::ofstream file_ {};
+    bool first_ {true};
 };
 
 [[nodiscard]] auto create_face_from_file(const char *filename, uint32_t face_index = 0)
@@ -85,6 +1080,44 @@ struct Font {
 
 [[nodiscard]] auto create_font(const FontFace &face, float font_size) -> Font;
 
+// width of one column in pixels for fixed-pitch fonts, else zero,
+// so lines of n columns are n times as wide
+[[nodiscard]] auto monospace_column_width(const Font &font) -> double;
+
+struct FontLoadOptions {
+    uint32_t face_index {};
+    // loads the cmap and the GSUB and GPOS accelerators on the worker
+    bool prewarm_tables {true};
+};
+
+/**
+ * @brief Loads font faces on a pool of worker threads.
+ *
+ * File I/O, Blend2D face creation and HarfBuzz face setup run on the workers,
+ * so the calling thread doesn't block. Futures of loads that were stopped
+ * through their stop token, or that were pending when the loader was destroyed,
+ * throw std::runtime_error, as do loads that fail.
+ */
+class FontLoader {
+   public:
+    explicit FontLoader(std::size_t thread_count = 2);
+
+    FontLoader(const FontLoader &) = delete;
+    FontLoader(FontLoader &&) noexcept;
+    auto operator=(const FontLoader &) -> FontLoader & = delete;
+    auto operator=(FontLoader &&) noexcept -> FontLoader &;
+    ~FontLoader();
+
+    [[nodiscard]] auto load(std::string filename, const FontLoadOptions &options = {},
+                            std::stop_token stop_token = {}) -> std::future<FontFace>;
+
+    // loads waiting for a worker
+    [[nodiscard]] auto pending() const -> std::size_t;
+
+   private:
+    std::unique_ptr<detail::FontLoaderState> state_;
+};
+
 }  // namespace blend2d_shaping
 
 #endif
\ No newline at end of file
@@ -0,0 +1,60 @@
+#include <gtest/gtest.h>
+
+#include <array>
+#include <string_view>
+#include <vector>
+
+#include "blend2d_shaping.h"
+#include "test_common.h"
+
+namespace blend2d_shaping {
+
+using test_common::get_font;
+using test_common::get_glyphs;
+
+namespace {
+
+[[nodiscard]] auto harfbuzz_options() -> ShapingOptions {
+    return ShapingOptions {.backend_policy = ShapingBackendPolicy::harfbuzz};
+}
+
+}  // namespace
+
+TEST(AttributedText, SingleRunMatchesShapedText) {
+    constexpr auto text = std::string_view {"AVATAR Wave"};
+    const auto runs = std::array {
+        AttributedRun {.byte_begin = 0, .byte_end = text.size(), .font = get_font()},
+    };
+
+    const auto attributed = AttributedText {text, runs};
+    const auto shaped = HbShapedText {text, get_font(), harfbuzz_options()};
+
+    ASSERT_EQ(attributed.run_count(), 1U);
+    EXPECT_EQ(get_glyphs(attributed.glyph_run(0)), get_glyphs(shaped.glyph_run()));
+    EXPECT_DOUBLE_EQ(attributed.advance().x, shaped.advance().x);
+}
+
+TEST(AttributedText, RunsShapeWithTheirFeatures) {
+    constexpr auto text = std::string_view {"12:30 AVATAR"};
+    const auto features =
+        std::vector {FontFeature {.tag = BL_MAKE_TAG('t', 'n', 'u', 'm')}};
+    const auto runs = std::array {
+        AttributedRun {.byte_begin = 0, .byte_end = 5, .font = get_font(),
+                       .features = features},
+        AttributedRun {.byte_begin = 5, .byte_end = text.size(), .font = get_font()},
+    };
+
+    const auto attributed = AttributedText {text, runs};
+
+    auto options = harfbuzz_options();
+    options.features = features;
+    const auto numbers = HbShapedText {text.substr(0, 5), get_font(), options};
+
+    ASSERT_EQ(attributed.run_count(), 2U);
+    EXPECT_EQ(get_glyphs(attributed.glyph_run(0)), get_glyphs(numbers.glyph_run()));
+    EXPECT_DOUBLE_EQ(attributed.origin(1).x, numbers.advance().x);
+    EXPECT_EQ(attributed.clusters().size(),
+              attributed.glyph_run(0).size + attributed.glyph_run(1).size);
+}
+
+}  // namespace blend2d_shaping
@@ -0,0 +1,57 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <future>
+#include <stdexcept>
+#include <stop_token>
+#include <vector>
+
+#include "blend2d_shaping.h"
+#include "test_common.h"
+
+namespace blend2d_shaping {
+
+TEST(FontLoader, LoadsFace) {
+    auto loader = FontLoader {1};
+    auto future = loader.load(BLEND2D_SHAPING_FONT_FILE);
+
+    const auto face = future.get();
+    EXPECT_EQ(face.bl_face.faceInfo().glyphCount,
+              test_common::get_font_face().bl_face.faceInfo().glyphCount);
+}
+
+TEST(FontLoader, MissingFileThrows) {
+    auto loader = FontLoader {1};
+    auto future = loader.load("does-not-exist.ttf");
+
+    EXPECT_THROW(future.get(), std::runtime_error);
+}
+
+TEST(FontLoader, StoppedLoadThrows) {
+    auto loader = FontLoader {1};
+    auto stop_source = std::stop_source {};
+    stop_source.request_stop();
+
+    auto future = loader.load(BLEND2D_SHAPING_FONT_FILE, {}, stop_source.get_token());
+    EXPECT_THROW(future.get(), std::runtime_error);
+}
+
+TEST(FontLoader, DestructorCancelsPendingLoads) {
+    constexpr auto load_count = 64;
+
+    auto futures = std::vector<std::future<FontFace>> {};
+    {
+        auto loader = FontLoader {1};
+        for (int i = 0; i < load_count; ++i) {
+            futures.push_back(loader.load(BLEND2D_SHAPING_FONT_FILE));
+        }
+    }
+
+    // all futures are ready, the single worker can't have reached the last load
+    for (auto &future : futures) {
+        EXPECT_EQ(future.wait_for(std::chrono::seconds {0}), std::future_status::ready);
+    }
+    EXPECT_THROW(static_cast<void>(futures.back().get()), std::runtime_error);
+}
+
+}  // namespace blend2d_shaping
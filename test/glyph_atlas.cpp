@@ -0,0 +1,112 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+#include "blend2d_shaping.h"
+#include "test_common.h"
+
+namespace blend2d_shaping {
+
+using test_common::get_font;
+using test_common::get_glyphs;
+
+namespace {
+
+[[nodiscard]] auto glyph_id(std::string_view character) -> uint32_t {
+    const auto shaped = HbShapedText {character, get_font()};
+    return get_glyphs(shaped.glyph_run()).at(0).codepoint;
+}
+
+[[nodiscard]] auto same_area(const AtlasGlyph &a, const AtlasGlyph &b) -> bool {
+    return a.rect.x == b.rect.x && a.rect.y == b.rect.y && a.rect.w == b.rect.w &&
+           a.rect.h == b.rect.h && a.offset.x == b.offset.x && a.offset.y == b.offset.y;
+}
+
+}  // namespace
+
+TEST(GlyphAtlas, RasterizesGlyphsOnce) {
+    auto atlas = GlyphAtlas {256, 256};
+
+    const auto first = atlas.glyph(get_font(), glyph_id("A"));
+    const auto second = atlas.glyph(get_font(), glyph_id("A"));
+
+    ASSERT_TRUE(first.has_value());
+    ASSERT_TRUE(second.has_value());
+    EXPECT_TRUE(same_area(*first, *second));
+    EXPECT_GT(first->rect.w, 0);
+    EXPECT_EQ(atlas.rasterized_count(), 1U);
+}
+
+TEST(GlyphAtlas, SubpixelBinsAreSeparateEntries) {
+    auto atlas = GlyphAtlas {256, 256};
+
+    static_cast<void>(atlas.glyph(get_font(), glyph_id("A"), 0));
+    static_cast<void>(atlas.glyph(get_font(), glyph_id("A"), 1));
+    EXPECT_EQ(atlas.size(), 2U);
+}
+
+TEST(GlyphAtlas, GlyphsWithoutInkHaveNoArea) {
+    auto atlas = GlyphAtlas {256, 256};
+
+    const auto space = atlas.glyph(get_font(), glyph_id(" "));
+    ASSERT_TRUE(space.has_value());
+    EXPECT_EQ(space->rect.w, 0);
+    EXPECT_EQ(atlas.rasterized_count(), 0U);
+}
+
+TEST(GlyphAtlas, FacesWithTheSameDataShareEntries) {
+    auto atlas = GlyphAtlas {256, 256};
+    const auto other_face = create_face_from_file(BLEND2D_SHAPING_FONT_FILE);
+    const auto other_font = create_font(other_face, get_font().bl_font.size());
+
+    static_cast<void>(atlas.glyph(get_font(), glyph_id("A")));
+    static_cast<void>(atlas.glyph(other_font, glyph_id("A")));
+    EXPECT_EQ(atlas.rasterized_count(), 1U);
+}
+
+TEST(GlyphAtlas, ClearRemovesGlyphs) {
+    auto atlas = GlyphAtlas {256, 256};
+
+    static_cast<void>(atlas.glyph(get_font(), glyph_id("A")));
+    atlas.clear();
+    EXPECT_EQ(atlas.size(), 0U);
+    EXPECT_EQ(atlas.rasterized_count(), 0U);
+}
+
+TEST(GlyphAtlas, SnapshotRoundTrip) {
+    const auto filename = std::string {"blend2d_shaping_atlas_test.bin"};
+
+    auto atlas = GlyphAtlas {256, 256};
+    const auto a = atlas.glyph(get_font(), glyph_id("A"));
+    const auto g = atlas.glyph(get_font(), glyph_id("g"), 2);
+    ASSERT_TRUE(a.has_value());
+    ASSERT_TRUE(g.has_value());
+    atlas.save(filename.c_str());
+
+    auto loaded = GlyphAtlas {256, 256};
+    ASSERT_TRUE(loaded.load(filename.c_str()));
+    EXPECT_EQ(loaded.size(), atlas.size());
+
+    const auto loaded_a = loaded.glyph(get_font(), glyph_id("A"));
+    const auto loaded_g = loaded.glyph(get_font(), glyph_id("g"), 2);
+    ASSERT_TRUE(loaded_a.has_value());
+    ASSERT_TRUE(loaded_g.has_value());
+    EXPECT_TRUE(same_area(*loaded_a, *a));
+    EXPECT_TRUE(same_area(*loaded_g, *g));
+    EXPECT_EQ(loaded.rasterized_count(), 0U);
+
+    // atlases of another size don't accept the snapshot
+    auto other_size = GlyphAtlas {128, 128};
+    EXPECT_FALSE(other_size.load(filename.c_str()));
+
+    std::remove(filename.c_str());
+}
+
+TEST(GlyphAtlas, MissingSnapshotIsRejected) {
+    auto atlas = GlyphAtlas {256, 256};
+    EXPECT_FALSE(atlas.load("does-not-exist.bin"));
+}
+
+}  // namespace blend2d_shaping
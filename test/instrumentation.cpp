@@ -0,0 +1,56 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <numeric>
+
+#include "blend2d_shaping.h"
+#include "test_common.h"
+
+namespace blend2d_shaping {
+
+using test_common::get_font;
+
+namespace {
+
+[[nodiscard]] auto harfbuzz_options() -> ShapingOptions {
+    return ShapingOptions {.backend_policy = ShapingBackendPolicy::harfbuzz};
+}
+
+}  // namespace
+
+TEST(Instrumentation, SnapshotIsEmptyWhenCompiledOut) {
+    if (instrumentation_enabled()) {
+        GTEST_SKIP() << "built with BLEND2D_SHAPING_INSTRUMENTATION";
+    }
+    static_cast<void>(HbShapedText {"Hello", get_font(), harfbuzz_options()});
+
+    const auto snapshot = instrumentation_snapshot();
+    EXPECT_EQ(snapshot.shaped_texts, 0U);
+    EXPECT_EQ(snapshot.glyphs, 0U);
+    EXPECT_EQ(snapshot.stage(ShapingStage::shape).count, 0U);
+}
+
+TEST(Instrumentation, CountsShapedTextsAndStages) {
+    if (!instrumentation_enabled()) {
+        GTEST_SKIP() << "built without BLEND2D_SHAPING_INSTRUMENTATION";
+    }
+    const auto before = instrumentation_snapshot();
+    const auto text = HbShapedText {"Hello World", get_font(), harfbuzz_options()};
+    const auto after = instrumentation_snapshot();
+
+    EXPECT_EQ(after.shaped_texts, before.shaped_texts + 1);
+    EXPECT_EQ(after.glyphs, before.glyphs + text.glyph_run().size);
+
+    for (const auto stage : {ShapingStage::buffer_setup, ShapingStage::shape,
+                             ShapingStage::glyph_extraction, ShapingStage::bounds}) {
+        const auto &statistics = after.stage(stage);
+        EXPECT_GT(statistics.count, before.stage(stage).count);
+
+        // every timed call lands in one latency bucket
+        const auto bucketed = std::accumulate(statistics.histogram.begin(),
+                                              statistics.histogram.end(), uint64_t {0});
+        EXPECT_EQ(bucketed, statistics.count);
+    }
+}
+
+}  // namespace blend2d_shaping
@@ -0,0 +1,56 @@
+#include <gtest/gtest.h>
+
+#include "blend2d_shaping.h"
+#include "test_common.h"
+
+namespace blend2d_shaping {
+
+using test_common::get_font;
+using test_common::get_font_face;
+
+TEST(MemoryUsage, FaceReportsFontData) {
+    const auto usage = memory_usage(get_font_face());
+
+    // the font file is read once and shared by both libraries
+    EXPECT_GT(usage.hb_font_data, 0U);
+    EXPECT_EQ(usage.bl_font_data, 0U);
+    EXPECT_EQ(usage.total(), usage.hb_font_data);
+}
+
+TEST(MemoryReport, CountsSharedFacesOnce) {
+    const auto face_bytes = memory_usage(get_font_face()).total();
+    const auto copy = get_font_face();
+
+    auto report = MemoryReport {};
+    report.add(get_font_face());
+    report.add(copy);
+    EXPECT_EQ(report.face_bytes(), face_bytes);
+}
+
+TEST(MemoryReport, CountsFacesFreedAfterAddingSeparately) {
+    const auto face_bytes = memory_usage(get_font_face()).total();
+
+    auto report = MemoryReport {};
+    for (int i = 0; i < 2; ++i) {
+        // a face freed here could reuse the address of the previous one
+        const auto face = create_face_from_file(BLEND2D_SHAPING_FONT_FILE);
+        report.add(face);
+    }
+    EXPECT_EQ(report.face_bytes(), 2 * face_bytes);
+}
+
+TEST(MemoryReport, SumsTextsAndCaches) {
+    const auto text = HbShapedText {"Hello World", get_font()};
+    auto cache = ShapedTextCache {get_font(), 16};
+    static_cast<void>(cache.get("Hello"));
+
+    auto report = MemoryReport {};
+    report.add(text);
+    report.add(cache);
+
+    EXPECT_EQ(report.shaped_text_bytes(), text.memory_usage());
+    EXPECT_EQ(report.cache_bytes(), cache.memory_usage());
+    EXPECT_EQ(report.total_bytes(), text.memory_usage() + cache.memory_usage());
+}
+
+}  // namespace blend2d_shaping
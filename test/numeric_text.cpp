@@ -0,0 +1,67 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <array>
+#include <string_view>
+
+#include "blend2d_shaping.h"
+#include "test_common.h"
+
+namespace blend2d_shaping {
+
+using test_common::get_font;
+using test_common::get_glyphs;
+
+namespace {
+
+constexpr auto suffixes = std::array {std::string_view {" ms"}, std::string_view {"%"}};
+
+auto expect_same_as_shaping(const NumericTextShaper &shaper, std::string_view text,
+                            const HbShapedText &actual) -> void {
+    const auto expected = HbShapedText {text, get_font(), shaper.options()};
+
+    EXPECT_EQ(get_glyphs(actual.glyph_run()), get_glyphs(expected.glyph_run())) << text;
+    EXPECT_TRUE(std::ranges::equal(actual.clusters(), expected.clusters())) << text;
+    EXPECT_EQ(actual.text_size(), text.size()) << text;
+    EXPECT_EQ(actual.bounding_box(), expected.bounding_box()) << text;
+}
+
+}  // namespace
+
+TEST(NumericTextShaper, MatchesShaping) {
+    for (const auto tabular_figures : {true, false}) {
+        const auto shaper = NumericTextShaper {get_font(), suffixes, tabular_figures};
+
+        for (const auto text : {"0", "12.34 ms", "99%", "-0.5", "+1,000.25", "10:45",
+                                "1111", "7 ms", "", " ms"}) {
+            expect_same_as_shaping(shaper, text, shaper.shape(text));
+        }
+    }
+}
+
+TEST(NumericTextShaper, PreShapesNumbers) {
+    const auto shaper = NumericTextShaper {get_font(), suffixes};
+
+    EXPECT_TRUE(shaper.is_pre_shaped("1234567890"));
+    EXPECT_TRUE(shaper.is_pre_shaped("12.5 ms"));
+    EXPECT_FALSE(shaper.is_pre_shaped("12 kg"));
+    EXPECT_FALSE(shaper.is_pre_shaped("१२"));
+}
+
+TEST(NumericTextShaper, FallsBackForOtherText) {
+    const auto shaper = NumericTextShaper {get_font(), suffixes};
+
+    for (const auto text : {"12 kg", "१२", "AV 10"}) {
+        expect_same_as_shaping(shaper, text, shaper.shape(text));
+    }
+}
+
+TEST(NumericTextShaper, FormatsValues) {
+    const auto shaper = NumericTextShaper {get_font(), suffixes};
+
+    expect_same_as_shaping(shaper, "12.5 ms", shaper.format(12.5, 1, " ms"));
+    expect_same_as_shaping(shaper, "-3%", shaper.format(-3.0, 0, "%"));
+    expect_same_as_shaping(shaper, "0.250", shaper.format(0.25, 3));
+}
+
+}  // namespace blend2d_shaping
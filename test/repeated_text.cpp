@@ -0,0 +1,95 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <string>
+#include <string_view>
+
+#include "blend2d_shaping.h"
+#include "test_common.h"
+
+namespace blend2d_shaping {
+
+using test_common::get_font;
+using test_common::get_glyphs;
+
+namespace {
+
+[[nodiscard]] auto repeat(std::string_view unit, std::size_t count) -> std::string {
+    auto result = std::string {};
+    for (std::size_t i = 0; i < count; ++i) {
+        result.append(unit);
+    }
+    return result;
+}
+
+// the backend the automatic policy uses, which shapes the whole text
+[[nodiscard]] auto explicit_options(std::string_view text) -> ShapingOptions {
+    return ShapingOptions {
+        .backend_policy = select_shaping_backend(text) == ShapingBackend::harfbuzz
+                              ? ShapingBackendPolicy::harfbuzz
+                              : ShapingBackendPolicy::blend2d,
+    };
+}
+
+}  // namespace
+
+class RepeatedText : public testing::TestWithParam<std::string_view> {};
+
+TEST_P(RepeatedText, TilingMatchesWholeText) {
+    for (const auto count : {8, 9, 33, 200}) {
+        const auto text = repeat(GetParam(), count);
+
+        const auto tiled = HbShapedText {text, get_font()};
+        const auto whole = HbShapedText {text, get_font(), explicit_options(text)};
+
+        EXPECT_EQ(get_glyphs(tiled.glyph_run()), get_glyphs(whole.glyph_run()));
+        EXPECT_TRUE(std::ranges::equal(tiled.clusters(), whole.clusters()));
+        EXPECT_EQ(tiled.bounding_box().x1, whole.bounding_box().x1);
+    }
+}
+
+INSTANTIATE_TEST_SUITE_P(Units, RepeatedText,
+                         testing::Values(".", "-", " .", "AV", "fi", "To ", "ab12",
+                                         "ـ", "سل", "दि"));
+
+TEST(FillToWidth, FitsWidth) {
+    const auto filled = fill_to_width(".", get_font(), 200.0);
+    const auto dot = HbShapedText {".", get_font()};
+
+    EXPECT_LE(filled.advance().x, 200.0);
+    EXPECT_GT(filled.advance().x + dot.advance().x, 200.0);
+}
+
+TEST(FillToWidth, FitsKernedCopies) {
+    const auto options =
+        ShapingOptions {.backend_policy = ShapingBackendPolicy::harfbuzz};
+
+    for (const auto width : {5.0, 20.0, 200.0, 1000.0}) {
+        const auto filled = fill_to_width("AV", get_font(), width, options);
+        const auto count = filled.text_size() / 2;
+
+        EXPECT_LE(filled.advance().x, width);
+        EXPECT_GT(HbShapedText(repeat("AV", count + 1), get_font(), options).advance().x,
+                  width);
+        EXPECT_EQ(filled, HbShapedText(repeat("AV", count), get_font(), options));
+    }
+}
+
+TEST(FillToWidth, ShapesTwice) {
+    if (!instrumentation_enabled()) {
+        GTEST_SKIP() << "built without BLEND2D_SHAPING_INSTRUMENTATION";
+    }
+    const auto shape_count = [] {
+        return instrumentation_snapshot().stage(ShapingStage::shape).count;
+    };
+    const auto options =
+        ShapingOptions {.backend_policy = ShapingBackendPolicy::harfbuzz};
+
+    const auto before = shape_count();
+    static_cast<void>(fill_to_width(".", get_font(), 500.0, options));
+
+    // a sample of copies to measure and the result
+    EXPECT_LE(shape_count() - before, 2U);
+}
+
+}  // namespace blend2d_shaping
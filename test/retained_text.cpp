@@ -0,0 +1,125 @@
+#include <gtest/gtest.h>
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+
+#include "blend2d_shaping.h"
+#include "test_common.h"
+
+namespace blend2d_shaping {
+
+using test_common::get_font;
+using test_common::get_glyphs;
+
+namespace {
+
+// bounds are rounded outwards to whole pixels
+auto expect_pixel_box(const BLBox &actual, const BLBox &expected) -> void {
+    EXPECT_EQ(actual.x0, std::floor(expected.x0));
+    EXPECT_EQ(actual.y0, std::floor(expected.y0));
+    EXPECT_EQ(actual.x1, std::ceil(expected.x1));
+    EXPECT_EQ(actual.y1, std::ceil(expected.y1));
+}
+
+}  // namespace
+
+//
+// Shaped Text Store
+//
+
+TEST(ShapedTextStore, RoundTripsTexts) {
+    const auto first = HbShapedText {"Main Street", get_font()};
+    const auto second = HbShapedText {"AVATAR", get_font()};
+
+    auto store = ShapedTextStore {};
+    const auto first_handle = store.append(first);
+    const auto second_handle = store.append(second);
+
+    EXPECT_EQ(store.size(), 2U);
+    EXPECT_EQ(store.glyph_count(), first.glyph_run().size + second.glyph_run().size);
+    EXPECT_EQ(get_glyphs(store.glyph_run(first_handle)), get_glyphs(first.glyph_run()));
+    EXPECT_EQ(get_glyphs(store.glyph_run(second_handle)), get_glyphs(second.glyph_run()));
+    expect_pixel_box(store.bounding_box(second_handle), second.bounding_box());
+}
+
+TEST(ShapedTextStore, ClampsLargeBounds) {
+    const auto text = HbShapedText {"Main Street", get_font()};
+
+    auto store = ShapedTextStore {};
+    const auto handle = store.append(text.glyph_run(), BLBox {-1e6, -0.5, 0.25, 1e6});
+    EXPECT_EQ(store.bounding_box(handle), (BLBox {-32768, -1, 1, 32767}));
+}
+
+TEST(ShapedTextStore, CompactKeepsHandles) {
+    const auto texts = std::array {
+        HbShapedText {"one", get_font()},
+        HbShapedText {"two", get_font()},
+        HbShapedText {"three", get_font()},
+    };
+
+    auto store = ShapedTextStore {};
+    auto handles = std::array<ShapedTextHandle, 3> {};
+    for (std::size_t i = 0; i < texts.size(); ++i) {
+        handles[i] = store.append(texts[i]);
+    }
+
+    store.erase(handles[1]);
+    EXPECT_FALSE(store.contains(handles[1]));
+    EXPECT_EQ(store.erased_glyph_count(), texts[1].glyph_run().size);
+
+    store.compact();
+    EXPECT_EQ(store.erased_glyph_count(), 0U);
+    EXPECT_EQ(store.size(), 2U);
+    EXPECT_EQ(get_glyphs(store.glyph_run(handles[0])), get_glyphs(texts[0].glyph_run()));
+    EXPECT_EQ(get_glyphs(store.glyph_run(handles[2])), get_glyphs(texts[2].glyph_run()));
+
+    // the erased handle is reused
+    const auto reused = store.append(texts[1]);
+    EXPECT_EQ(reused, handles[1]);
+    EXPECT_EQ(get_glyphs(store.glyph_run(reused)), get_glyphs(texts[1].glyph_run()));
+    EXPECT_EQ(store.handle_count(), 3U);
+}
+
+//
+// Compact Shaped Text
+//
+
+TEST(CompactShapedText, RoundTripsText) {
+    const auto text = HbShapedText {"AVATAR To Wave", get_font()};
+    const auto compact = CompactShapedText {text};
+
+    auto buffer = ShapedTextBuffer {};
+    compact.expand(buffer);
+
+    EXPECT_EQ(compact.size(), text.glyph_run().size);
+    EXPECT_EQ(get_glyphs(buffer.glyph_run()), get_glyphs(text.glyph_run()));
+    EXPECT_EQ(compact.advance(), text.advance());
+    EXPECT_EQ(compact.bounding_box(), text.bounding_box());
+    EXPECT_LT(compact.memory_usage(), text.memory_usage());
+}
+
+TEST(CompactShapedText, RoundTripsWideGlyphsAndSparsePlacements) {
+    // ids beyond 16 bits, an offset, a y-advance and an advance beyond 16 bits
+    const auto codepoints = std::array<uint32_t, 4> {3, 70'000, 5, 6};
+    const auto placements = std::array {
+        BLGlyphPlacement {.placement = BLPointI {}, .advance = BLPointI {500, 0}},
+        BLGlyphPlacement {.placement = BLPointI {10, -20}, .advance = BLPointI {0, 0}},
+        BLGlyphPlacement {.placement = BLPointI {}, .advance = BLPointI {600, 40}},
+        BLGlyphPlacement {.placement = BLPointI {}, .advance = BLPointI {40'000, 0}},
+    };
+
+    auto glyph_run = BLGlyphRun {};
+    glyph_run.setGlyphData(codepoints.data());
+    glyph_run.setPlacementData(placements.data());
+    glyph_run.size = codepoints.size();
+    glyph_run.placementType = BL_GLYPH_PLACEMENT_TYPE_ADVANCE_OFFSET;
+
+    const auto compact = CompactShapedText {glyph_run, BLBox {}, BLPoint {}};
+    auto buffer = ShapedTextBuffer {};
+    compact.expand(buffer);
+
+    EXPECT_EQ(get_glyphs(buffer.glyph_run()), get_glyphs(glyph_run));
+}
+
+}  // namespace blend2d_shaping
@@ -0,0 +1,262 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "blend2d_shaping.h"
+#include "test_common.h"
+
+namespace blend2d_shaping {
+
+using test_common::get_font;
+using test_common::get_glyphs;
+
+namespace {
+
+// the automatic policy shapes simple text with Blend2D and derived glyph flags
+constexpr auto splice_policies =
+    std::array {ShapingBackendPolicy::automatic, ShapingBackendPolicy::blend2d,
+                ShapingBackendPolicy::harfbuzz};
+
+auto expect_same_glyphs(const HbShapedText &actual, const HbShapedText &expected,
+                        std::string_view text) -> void {
+    EXPECT_EQ(get_glyphs(actual.glyph_run()), get_glyphs(expected.glyph_run())) << text;
+    EXPECT_TRUE(std::ranges::equal(actual.clusters(), expected.clusters())) << text;
+    EXPECT_EQ(actual.text_size(), expected.text_size()) << text;
+}
+
+// not a UTF-8 continuation byte
+[[nodiscard]] auto is_code_point_start(std::string_view text, std::size_t offset)
+    -> bool {
+    return offset == text.size() || (static_cast<uint8_t>(text[offset]) & 0xC0) != 0x80;
+}
+
+}  // namespace
+
+//
+// Styled Glyph Runs
+//
+
+TEST(StyledGlyphRuns, SplitsAtStyleBoundaries) {
+    const auto text = HbShapedText {"Hello World", get_font()};
+    const auto runs = std::array {
+        StyleRun {.byte_begin = 0, .byte_end = 5, .style = 1},
+        StyleRun {.byte_begin = 6, .byte_end = 11, .style = 2},
+    };
+
+    const auto styled = text.styled_glyph_runs(runs, 7);
+    ASSERT_EQ(styled.size(), 3U);
+    EXPECT_EQ(styled[0].style, 1U);
+    EXPECT_EQ(styled[1].style, 7U);
+    EXPECT_EQ(styled[2].style, 2U);
+
+    auto glyph_count = std::size_t {0};
+    for (const auto &run : styled) {
+        glyph_count += run.glyph_run.size;
+    }
+    EXPECT_EQ(glyph_count, text.glyph_run().size);
+
+    EXPECT_EQ(styled[0].origin.x, 0.0);
+    EXPECT_LT(styled[1].origin.x, styled[2].origin.x);
+    EXPECT_LT(styled[2].origin.x, text.advance().x);
+}
+
+TEST(StyledGlyphRuns, UncoveredTextHasDefaultStyle) {
+    const auto text = HbShapedText {"Hello", get_font()};
+
+    const auto styled = text.styled_glyph_runs({}, 3);
+    ASSERT_EQ(styled.size(), 1U);
+    EXPECT_EQ(styled[0].style, 3U);
+    EXPECT_EQ(styled[0].glyph_run.size, text.glyph_run().size);
+}
+
+//
+// Editable Shaped Text
+//
+
+TEST(EditableShapedText, AppendMatchesShapingTheWholeText) {
+    // kerning pairs at the seam, joining Arabic and reordering Devanagari
+    const auto pairs = std::array {
+        std::array {std::string_view {"AV"}, std::string_view {"AV"}},
+        std::array {std::string_view {"To"}, std::string_view {"Wa"}},
+        std::array {std::string_view {"Hello "}, std::string_view {"World"}},
+        std::array {std::string_view {"f"}, std::string_view {"i"}},
+        std::array {std::string_view {"مر"}, std::string_view {"حبا"}},
+        std::array {std::string_view {"سلام "}, std::string_view {"عليكم"}},
+        std::array {std::string_view {"क"}, std::string_view {"ि"}},
+        std::array {std::string_view {"Hello "}, std::string_view {"مرحبا"}},
+    };
+
+    for (const auto policy : splice_policies) {
+        const auto options = ShapingOptions {.backend_policy = policy};
+
+        for (const auto &[left, right] : pairs) {
+            const auto text = std::string {left} + std::string {right};
+            const auto whole = HbShapedText {text, get_font(), options};
+
+            auto appended = EditableShapedText {left, get_font(), options};
+            appended.append(right);
+            expect_same_glyphs(appended.shaped(), whole, text);
+            EXPECT_EQ(appended.text_utf8(), text);
+
+            const auto joined =
+                concat(EditableShapedText {left, get_font(), options},
+                       EditableShapedText {right, get_font(), options});
+            expect_same_glyphs(joined.shaped(), whole, text);
+        }
+    }
+}
+
+TEST(EditableShapedText, GrowingTextMatchesShapingTheWholeText) {
+    const auto words = std::array {std::string_view {"AWAY "}, std::string_view {"To"},
+                                   std::string_view {"VA. "}, std::string_view {"fi "},
+                                   std::string_view {"سلام"}};
+
+    for (const auto policy : splice_policies) {
+        const auto options = ShapingOptions {.backend_policy = policy};
+
+        auto text = std::string {};
+        auto appended = EditableShapedText {"", get_font(), options};
+        for (int i = 0; i < 12; ++i) {
+            const auto word = words[static_cast<std::size_t>(i) % words.size()];
+            text.append(word);
+            appended.append(word);
+
+            expect_same_glyphs(appended.shaped(),
+                               HbShapedText {text, get_font(), options}, text);
+        }
+    }
+}
+
+TEST(EditableShapedText, AppendingReshapesFewWindows) {
+    if (!instrumentation_enabled()) {
+        GTEST_SKIP() << "built without BLEND2D_SHAPING_INSTRUMENTATION";
+    }
+    const auto shape_count = [] {
+        return instrumentation_snapshot().stage(ShapingStage::shape).count;
+    };
+    constexpr auto append_count = 64;
+
+    for (const auto policy : splice_policies) {
+        const auto options = ShapingOptions {.backend_policy = policy};
+        auto appended = EditableShapedText {"", get_font(), options};
+
+        const auto before = shape_count();
+        for (int i = 0; i < append_count; ++i) {
+            appended.append("Wave To ");
+        }
+        const auto shapes = shape_count() - before;
+
+        // each word and a few windows at its seam, independent of the text length
+        EXPECT_LE(shapes, uint64_t {4 * append_count});
+    }
+}
+
+TEST(EditableShapedText, SliceMatchesShapingTheRange) {
+    const auto text = std::string_view {"AVATAR To Wa fi مرحبا"};
+
+    for (const auto policy : splice_policies) {
+        const auto options = ShapingOptions {.backend_policy = policy};
+        const auto editable = EditableShapedText {text, get_font(), options};
+
+        for (std::size_t begin = 0; begin <= text.size(); begin += 3) {
+            for (std::size_t end = begin; end <= text.size(); end += 5) {
+                if (!is_code_point_start(text, begin) ||
+                    !is_code_point_start(text, end)) {
+                    continue;
+                }
+                const auto range = text.substr(begin, end - begin);
+                const auto slice = editable.slice(begin, end);
+
+                EXPECT_EQ(slice.text_utf8(), range);
+                expect_same_glyphs(slice.shaped(),
+                                   HbShapedText {range, get_font(), options}, range);
+            }
+        }
+    }
+}
+
+TEST(EditableShapedText, SafeToBreakAtTextEnds) {
+    const auto text = HbShapedText {"AV", get_font()};
+
+    EXPECT_TRUE(text.is_safe_to_break(0));
+    EXPECT_TRUE(text.is_safe_to_break(text.text_size()));
+}
+
+TEST(EditableShapedText, UnsafeToBreakInsideKerningPairsAndCodePoints) {
+    const auto options =
+        ShapingOptions {.backend_policy = ShapingBackendPolicy::harfbuzz};
+
+    // NotoSans kerns the pair
+    const auto kerned = EditableShapedText {"AVA", get_font(), options};
+    EXPECT_FALSE(kerned.shaped().is_safe_to_break(1));
+    expect_same_glyphs(kerned.slice(0, 1).shaped(),
+                       HbShapedText {"A", get_font(), options}, "A");
+    expect_same_glyphs(kerned.slice(1, 3).shaped(),
+                       HbShapedText {"VA", get_font(), options}, "VA");
+
+    // the second byte of the two-byte letter doesn't start a cluster
+    const auto accented = HbShapedText {"xéx", get_font(), options};
+    EXPECT_FALSE(accented.is_safe_to_break(2));
+    EXPECT_TRUE(accented.is_safe_to_break(3));
+}
+
+//
+// Text Diff
+//
+
+TEST(ShapedTextDiff, EqualTextsHaveNoChanges) {
+    const auto text = HbShapedText {"Hello World", get_font()};
+
+    const auto result = diff(text, text, get_font().hb_font);
+    EXPECT_TRUE(result.empty());
+    EXPECT_EQ(result.dirty_box, BLBox {});
+}
+
+TEST(ShapedTextDiff, AppendedGlyphsAreAdded) {
+    const auto previous = HbShapedText {"Hello", get_font()};
+    const auto next = HbShapedText {"Hello world", get_font()};
+
+    const auto result = diff(previous, next, get_font().hb_font);
+    EXPECT_TRUE(result.removed.empty());
+    ASSERT_EQ(result.added.size(), 1U);
+    EXPECT_EQ(result.added.front().begin, previous.glyph_run().size);
+    EXPECT_EQ(result.added.front().end, next.glyph_run().size);
+
+    // the new ink lies right of the unchanged text
+    EXPECT_GE(result.dirty_box.x0, previous.bounding_box().x1 - 1.0);
+    EXPECT_LE(result.dirty_box.x1, next.bounding_box().x1);
+}
+
+TEST(ShapedTextDiff, ShiftedGlyphsChange) {
+    const auto previous = HbShapedText {"99 items", get_font()};
+    const auto next = HbShapedText {"100 items", get_font()};
+
+    const auto result = diff(previous, next, get_font().hb_font);
+    EXPECT_FALSE(result.removed.empty());
+    EXPECT_FALSE(result.added.empty());
+    EXPECT_EQ(result.removed.back().end, previous.glyph_run().size);
+    EXPECT_EQ(result.added.back().end, next.glyph_run().size);
+    EXPECT_LT(result.dirty_box.x0, result.dirty_box.x1);
+}
+
+TEST(ShapedTextDiff, OtherSizeChangesEverything) {
+    const auto small = HbShapedText {"Hello", get_font()};
+    const auto large = HbShapedText {"Hello", get_font().hb_font, 32.0f};
+
+    const auto result = diff(small, large, get_font().hb_font);
+    EXPECT_EQ(result.removed, (std::vector {GlyphRange {0, small.glyph_run().size}}));
+    EXPECT_EQ(result.added, (std::vector {GlyphRange {0, large.glyph_run().size}}));
+    for (const auto &box : {small.bounding_box(), large.bounding_box()}) {
+        EXPECT_LE(result.dirty_box.x0, box.x0);
+        EXPECT_LE(result.dirty_box.y0, box.y0);
+        EXPECT_GE(result.dirty_box.x1, box.x1);
+        EXPECT_GE(result.dirty_box.y1, box.y1);
+    }
+}
+
+}  // namespace blend2d_shaping
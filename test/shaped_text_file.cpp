@@ -0,0 +1,141 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "blend2d_shaping.h"
+#include "test_common.h"
+
+namespace blend2d_shaping {
+
+using test_common::get_font;
+using test_common::get_font_face;
+using test_common::get_glyphs;
+
+namespace {
+
+const auto filename = std::string {"blend2d_shaping_file_test.bin"};
+
+[[nodiscard]] auto create_texts(const ShapingOptions &options = {})
+    -> std::vector<EditableShapedText> {
+    auto result = std::vector<EditableShapedText> {};
+    for (const auto text : {"Main Street", "AVATAR", "", "مرحبا"}) {
+        result.emplace_back(text, get_font(), options);
+    }
+    return result;
+}
+
+[[nodiscard]] auto read_file() -> std::vector<char> {
+    auto stream = std::ifstream {filename, std::ios::binary};
+    return std::vector<char>(std::istreambuf_iterator<char> {stream}, {});
+}
+
+auto write_file(const std::vector<char> &data) -> void {
+    auto stream = std::ofstream {filename, std::ios::binary | std::ios::trunc};
+    stream.write(data.data(), static_cast<std::streamsize>(data.size()));
+}
+
+}  // namespace
+
+TEST(ShapedTextFile, RoundTripsTexts) {
+    const auto texts = create_texts();
+    write_shaped_text_file(filename.c_str(), texts);
+
+    const auto file = ShapedTextFile {filename.c_str(), get_font()};
+    std::remove(filename.c_str());
+
+    ASSERT_FALSE(file.stale());
+    EXPECT_EQ(file.size(), texts.size());
+
+    for (const auto &text : texts) {
+        const auto view = file.find(text.text_utf8());
+        ASSERT_TRUE(view.has_value()) << text.text_utf8();
+
+        const auto &shaped = text.shaped();
+        EXPECT_EQ(get_glyphs(view->glyph_run), get_glyphs(shaped.glyph_run()));
+        EXPECT_TRUE(std::ranges::equal(view->clusters, shaped.clusters()));
+        EXPECT_EQ(view->advance, shaped.advance());
+        EXPECT_EQ(view->bounding_box, shaped.bounding_box());
+    }
+    EXPECT_FALSE(file.find("Side Street").has_value());
+}
+
+TEST(ShapedTextFile, OtherOptionsAreStale) {
+    const auto options =
+        ShapingOptions {.backend_policy = ShapingBackendPolicy::harfbuzz};
+    write_shaped_text_file(filename.c_str(), create_texts(options));
+
+    const auto matching = ShapedTextFile {filename.c_str(), get_font(), options};
+    const auto other = ShapedTextFile {filename.c_str(), get_font()};
+    const auto other_size =
+        ShapedTextFile {filename.c_str(), create_font(get_font_face(), 20.0f), options};
+    std::remove(filename.c_str());
+
+    EXPECT_FALSE(matching.stale());
+    EXPECT_TRUE(other.stale());
+    EXPECT_TRUE(other_size.stale());
+    EXPECT_FALSE(other.find("Main Street").has_value());
+}
+
+TEST(ShapedTextFile, MissingFileIsStale) {
+    const auto file = ShapedTextFile {"blend2d_shaping_missing.bin", get_font()};
+
+    EXPECT_TRUE(file.stale());
+    EXPECT_EQ(file.size(), 0U);
+}
+
+TEST(ShapedTextFile, ShapesMissesWithTheFileOptions) {
+    const auto options =
+        ShapingOptions {.backend_policy = ShapingBackendPolicy::harfbuzz};
+    write_shaped_text_file(filename.c_str(), create_texts(options));
+
+    auto file = ShapedTextFile {filename.c_str(), get_font(), options};
+    auto stale = ShapedTextFile {filename.c_str(), get_font()};
+    std::remove(filename.c_str());
+
+    const auto stored = file.find_or_shape("AVATAR");
+    EXPECT_EQ(stored.glyph_run.glyphData, file.find("AVATAR")->glyph_run.glyphData);
+    EXPECT_EQ(file.misses(), 0U);
+
+    const auto missing = HbShapedText {"Side Street", get_font(), options};
+    const auto shaped = file.find_or_shape("Side Street");
+    EXPECT_EQ(get_glyphs(shaped.glyph_run), get_glyphs(missing.glyph_run()));
+    EXPECT_EQ(shaped.advance, missing.advance());
+    EXPECT_EQ(file.misses(), 1U);
+
+    // every lookup of a stale file is shaped again
+    const auto reshaped = stale.find_or_shape("AVATAR");
+    EXPECT_EQ(get_glyphs(reshaped.glyph_run),
+              get_glyphs(HbShapedText {"AVATAR", get_font()}.glyph_run()));
+    EXPECT_EQ(stale.misses(), 1U);
+}
+
+TEST(ShapedTextFile, DamagedFilesAreStale) {
+    write_shaped_text_file(filename.c_str(), create_texts());
+    const auto data = read_file();
+
+    auto truncated = data;
+    truncated.pop_back();
+    write_file(truncated);
+    EXPECT_TRUE(ShapedTextFile(filename.c_str(), get_font()).stale());
+
+    // glyph count of the header, after magic, version, entry count and hashes,
+    // whose size in bytes overflows 64 bits
+    constexpr auto glyph_count_offset = std::size_t {32};
+    auto overflowing = data;
+    const auto glyph_count = std::numeric_limits<uint64_t>::max() / 4;
+    std::copy_n(reinterpret_cast<const char *>(&glyph_count), sizeof(glyph_count),
+                overflowing.begin() + glyph_count_offset);
+    write_file(overflowing);
+    EXPECT_TRUE(ShapedTextFile(filename.c_str(), get_font()).stale());
+
+    std::remove(filename.c_str());
+}
+
+}  // namespace blend2d_shaping
@@ -0,0 +1,43 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <string_view>
+#include <vector>
+
+#include "blend2d_shaping.h"
+#include "test_common.h"
+
+namespace blend2d_shaping {
+
+using test_common::get_font;
+using test_common::get_glyphs;
+
+namespace {
+
+const auto features = std::vector {FontFeature {.tag = BL_MAKE_TAG('t', 'n', 'u', 'm')}};
+
+}  // namespace
+
+TEST(Shaper, MatchesShaping) {
+    const auto options = ShapingOptions {
+        .backend_policy = ShapingBackendPolicy::harfbuzz,
+        .features = features,
+    };
+    auto shaper = Shaper {get_font(), features};
+    auto buffer = ShapedTextBuffer {};
+
+    // longer texts first, so later ones reuse the capacity
+    for (const auto text : {"AVATAR To Wave 1234", "office", "Hello", ""}) {
+        shaper.shape(text, buffer);
+        const auto expected = HbShapedText {text, get_font(), options};
+
+        EXPECT_EQ(get_glyphs(buffer.glyph_run()), get_glyphs(expected.glyph_run()))
+            << text;
+        EXPECT_TRUE(std::ranges::equal(buffer.clusters(), expected.clusters())) << text;
+        EXPECT_EQ(buffer.advance(), expected.advance()) << text;
+        EXPECT_EQ(buffer.bounding_box(), expected.bounding_box()) << text;
+    }
+    EXPECT_TRUE(buffer.empty());
+}
+
+}  // namespace blend2d_shaping
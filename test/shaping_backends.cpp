@@ -0,0 +1,146 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <array>
+#include <string_view>
+#include <vector>
+
+#include "blend2d_shaping.h"
+#include "test_common.h"
+
+namespace blend2d_shaping {
+
+using test_common::get_font;
+using test_common::get_glyphs;
+
+namespace {
+
+constexpr auto sample = std::string_view {"AVATAR 0123456789 Wave"};
+
+[[nodiscard]] auto proportional_figures() -> std::vector<FontFeature> {
+    return {FontFeature {.tag = BL_MAKE_TAG('p', 'n', 'u', 'm')}};
+}
+
+}  // namespace
+
+TEST(ShapingBackends, SelectsHarfBuzzForComplexScriptsAndFeatures) {
+    EXPECT_EQ(select_shaping_backend("Simple Text"), ShapingBackend::blend2d);
+    EXPECT_EQ(select_shaping_backend("نص حكيم"), ShapingBackend::harfbuzz);
+    EXPECT_EQ(select_shaping_backend("Simple Text", {.features = proportional_figures()}),
+              ShapingBackend::harfbuzz);
+}
+
+TEST(ShapingBackends, RightToLeftTextIsInVisualOrder) {
+    const auto text = HbShapedText {"سلام عليكم", get_font()};
+    ASSERT_FALSE(text.empty());
+
+    // the last letter comes first
+    EXPECT_EQ(text.clusters().front(), 17U);
+    EXPECT_EQ(text.clusters().back(), 0U);
+    EXPECT_TRUE(text.is_safe_to_break(9));
+    EXPECT_FALSE(text.is_safe_to_break(10));
+
+    const auto devanagari = HbShapedText {"कि दि", get_font()};
+    EXPECT_TRUE(std::ranges::is_sorted(devanagari.clusters()));
+}
+
+TEST(ShapingBackends, FeaturesAreNotDroppedByBlend2D) {
+    const auto harfbuzz = HbShapedText {
+        sample, get_font(),
+        {.backend_policy = ShapingBackendPolicy::harfbuzz,
+         .features = proportional_figures()}};
+    const auto blend2d = HbShapedText {
+        sample, get_font(),
+        {.backend_policy = ShapingBackendPolicy::blend2d,
+         .features = proportional_figures()}};
+
+    EXPECT_EQ(get_glyphs(blend2d.glyph_run()), get_glyphs(harfbuzz.glyph_run()));
+}
+
+TEST(ShapingBackends, FeaturesAreNotDroppedByLighterQualities) {
+    const auto full =
+        HbShapedText {sample, get_font(), {.features = proportional_figures()}};
+
+    for (const auto quality : {ShapingQuality::kerning_only, ShapingQuality::nominal,
+                               ShapingQuality::monospace}) {
+        const auto light = HbShapedText {
+            sample, get_font(), {.quality = quality, .features = proportional_figures()}};
+        EXPECT_EQ(get_glyphs(light.glyph_run()), get_glyphs(full.glyph_run()));
+    }
+}
+
+TEST(ShapingBackends, ParityOfSimpleText) {
+    const auto parity = check_shaping_parity(sample, get_font());
+    EXPECT_TRUE(parity.equal());
+}
+
+TEST(ShapingQuality, NominalUsesCmapGlyphs) {
+    // no ligatures or marks in the sample, so only positions can differ
+    const auto full = HbShapedText {sample, get_font()};
+    const auto nominal =
+        HbShapedText {sample, get_font(), {.quality = ShapingQuality::nominal}};
+
+    const auto full_glyphs = get_glyphs(full.glyph_run());
+    const auto nominal_glyphs = get_glyphs(nominal.glyph_run());
+    ASSERT_EQ(full_glyphs.size(), nominal_glyphs.size());
+    for (std::size_t i = 0; i < full_glyphs.size(); ++i) {
+        EXPECT_EQ(full_glyphs[i].codepoint, nominal_glyphs[i].codepoint);
+    }
+}
+
+TEST(ShapingQuality, KerningOnlyKerns) {
+    const auto kerned =
+        HbShapedText {"AV", get_font(), {.quality = ShapingQuality::kerning_only}};
+    const auto nominal =
+        HbShapedText {"AV", get_font(), {.quality = ShapingQuality::nominal}};
+
+    EXPECT_LT(kerned.advance().x, nominal.advance().x);
+}
+
+TEST(ShapingQuality, GlyphFlagsAreOnlyDerivedForEditing) {
+    const auto lighter = std::array {
+        ShapingOptions {.backend_policy = ShapingBackendPolicy::blend2d},
+        ShapingOptions {.quality = ShapingQuality::kerning_only},
+    };
+
+    for (const auto &options : lighter) {
+        // without flags only the ends are known to be safe
+        const auto plain = HbShapedText {"ab cd", get_font(), options};
+        EXPECT_FALSE(plain.is_safe_to_break(3));
+
+        const auto editable = EditableShapedText {"ab cd", get_font(), options};
+        EXPECT_TRUE(editable.shaped().is_safe_to_break(3));
+        EXPECT_EQ(editable.shaped(), plain);
+    }
+}
+
+TEST(ShapingQuality, MonospaceFallsBackForProportionalFonts) {
+    EXPECT_EQ(get_font().fixed_advance, 0);
+    EXPECT_EQ(monospace_column_width(get_font()), 0.0);
+
+    const auto monospace =
+        HbShapedText {sample, get_font(), {.quality = ShapingQuality::monospace}};
+    const auto nominal =
+        HbShapedText {sample, get_font(), {.quality = ShapingQuality::nominal}};
+    EXPECT_EQ(get_glyphs(monospace.glyph_run()), get_glyphs(nominal.glyph_run()));
+}
+
+TEST(ShapingQuality, MonospacePlacesGlyphsInColumns) {
+    // as if the face was detected as fixed-pitch
+    auto font = get_font();
+    font.fixed_advance = 1200;
+
+    const auto text = std::string_view {"ls -la | grep x"};
+    const auto monospace =
+        HbShapedText {text, font, {.quality = ShapingQuality::monospace}};
+    const auto column_width = monospace_column_width(font);
+
+    EXPECT_GT(column_width, 0.0);
+    EXPECT_EQ(monospace.glyph_run().size, text.size());
+    EXPECT_NEAR(monospace.advance().x, column_width * text.size(), 1e-9);
+    for (const auto &glyph : get_glyphs(monospace.glyph_run())) {
+        EXPECT_EQ(glyph.placement.advance.x, 1200);
+    }
+}
+
+}  // namespace blend2d_shaping
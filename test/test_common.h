@@ -0,0 +1,50 @@
+#ifndef BLEND2D_SHAPING_TEST_COMMON_H
+#define BLEND2D_SHAPING_TEST_COMMON_H
+
+#include <cstdint>
+#include <vector>
+
+#include "blend2d_shaping.h"
+
+namespace blend2d_shaping::test_common {
+
+// bundled NotoSans-Regular.ttf, loaded once
+[[nodiscard]] inline auto get_font_face() -> const FontFace & {
+    static const auto face = create_face_from_file(BLEND2D_SHAPING_FONT_FILE);
+    return face;
+}
+
+[[nodiscard]] inline auto get_font() -> const Font & {
+    static const auto font = create_font(get_font_face(), 16.0f);
+    return font;
+}
+
+struct Glyph {
+    uint32_t codepoint {};
+    BLGlyphPlacement placement {};
+
+    [[nodiscard]] auto operator==(const Glyph &other) const -> bool {
+        return codepoint == other.codepoint &&
+               placement.placement.x == other.placement.placement.x &&
+               placement.placement.y == other.placement.placement.y &&
+               placement.advance.x == other.placement.advance.x &&
+               placement.advance.y == other.placement.advance.y;
+    }
+};
+
+// copies the glyphs, so runs of different texts compare by value
+[[nodiscard]] inline auto get_glyphs(const BLGlyphRun &glyph_run) -> std::vector<Glyph> {
+    auto result = std::vector<Glyph> {};
+    const auto *codepoints = static_cast<const uint32_t *>(glyph_run.glyphData);
+    const auto *placements =
+        static_cast<const BLGlyphPlacement *>(glyph_run.placementData);
+
+    for (std::size_t i = 0; i < glyph_run.size; ++i) {
+        result.push_back(Glyph {.codepoint = codepoints[i], .placement = placements[i]});
+    }
+    return result;
+}
+
+}  // namespace blend2d_shaping::test_common
+
+#endif
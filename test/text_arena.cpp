@@ -0,0 +1,68 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <array>
+#include <string_view>
+#include <vector>
+
+#include "blend2d_shaping.h"
+#include "test_common.h"
+
+namespace blend2d_shaping {
+
+using test_common::get_font;
+using test_common::get_glyphs;
+
+namespace {
+
+constexpr auto texts = std::array {std::string_view {"Main Street"},
+                                   std::string_view {"AVATAR"}, std::string_view {""},
+                                   std::string_view {"office 1234"}};
+
+auto expect_same_as_shaping(std::string_view text, const ShapedTextView &view) -> void {
+    const auto expected = HbShapedText {
+        text, get_font(), {.backend_policy = ShapingBackendPolicy::harfbuzz}};
+
+    EXPECT_EQ(get_glyphs(view.glyph_run), get_glyphs(expected.glyph_run())) << text;
+    EXPECT_TRUE(std::ranges::equal(view.clusters, expected.clusters())) << text;
+    EXPECT_EQ(view.advance, expected.advance()) << text;
+    EXPECT_EQ(view.bounding_box, expected.bounding_box()) << text;
+}
+
+}  // namespace
+
+TEST(TextArena, MatchesShaping) {
+    // small blocks, so texts span several of them
+    auto arena = TextArena {8};
+
+    auto views = std::vector<ShapedTextView> {};
+    for (const auto text : texts) {
+        views.push_back(arena.shape(text, get_font()));
+    }
+
+    // earlier views stay valid while later texts are shaped
+    auto glyph_count = std::size_t {0};
+    for (std::size_t i = 0; i < texts.size(); ++i) {
+        expect_same_as_shaping(texts[i], views[i]);
+        glyph_count += views[i].glyph_run.size;
+    }
+    EXPECT_EQ(arena.glyph_count(), glyph_count);
+}
+
+TEST(TextArena, ResetKeepsBlocks) {
+    auto arena = TextArena {8};
+    for (const auto text : texts) {
+        static_cast<void>(arena.shape(text, get_font()));
+    }
+    const auto memory_usage = arena.memory_usage();
+
+    arena.reset();
+    EXPECT_EQ(arena.glyph_count(), 0U);
+
+    for (const auto text : texts) {
+        expect_same_as_shaping(text, arena.shape(text, get_font()));
+    }
+    EXPECT_EQ(arena.memory_usage(), memory_usage);
+}
+
+}  // namespace blend2d_shaping
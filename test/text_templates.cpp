@@ -0,0 +1,102 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <array>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "blend2d_shaping.h"
+#include "test_common.h"
+
+namespace blend2d_shaping {
+
+using test_common::get_font;
+using test_common::get_glyphs;
+
+namespace {
+
+struct TemplateCase {
+    std::string_view pattern;
+    std::vector<std::string_view> fields;
+    std::string_view text;
+};
+
+}  // namespace
+
+TEST(ShapedTextTemplate, MatchesShapingTheWholeText) {
+    const auto cases = std::array {
+        // kerning pairs across the splice points
+        TemplateCase {"AV{0}AT", {"AV"}, "AVAVAT"},
+        TemplateCase {"To {0}. {1}Y", {"Wa", "V"}, "To Wa. VY"},
+        TemplateCase {"{0}{1}", {"f", "i"}, "fi"},
+        TemplateCase {"{0}", {""}, ""},
+        // joining and reordering scripts
+        TemplateCase {"مر{0}با", {"ح"}, "مرحبا"},
+        TemplateCase {"क{0} {1}", {"ि", "दि"}, "कि दि"},
+    };
+
+    for (const auto policy :
+         {ShapingBackendPolicy::automatic, ShapingBackendPolicy::harfbuzz}) {
+        const auto options = ShapingOptions {.backend_policy = policy};
+
+        for (const auto &item : cases) {
+            const auto label = ShapedTextTemplate {item.pattern, get_font(), options};
+            const auto spliced = label.instantiate(item.fields);
+            const auto whole = HbShapedText {item.text, get_font(), options};
+
+            EXPECT_EQ(get_glyphs(spliced.glyph_run()), get_glyphs(whole.glyph_run()))
+                << item.text;
+            EXPECT_TRUE(std::ranges::equal(spliced.clusters(), whole.clusters()))
+                << item.text;
+            EXPECT_EQ(spliced.text_size(), item.text.size());
+        }
+    }
+}
+
+TEST(ShapedTextTemplate, ReshapesFewWindowsAfterLongStaticText) {
+    if (!instrumentation_enabled()) {
+        GTEST_SKIP() << "built without BLEND2D_SHAPING_INSTRUMENTATION";
+    }
+    // kerned pairs throughout, shaped by Blend2D under the automatic policy
+    auto pattern = std::string {};
+    for (int i = 0; i < 40; ++i) {
+        pattern.append("Wave To ");
+    }
+    const auto text = pattern + "AV AT";
+    pattern.append("{0} AT");
+
+    const auto label = ShapedTextTemplate {pattern, get_font()};
+    const auto fields = std::array {std::string_view {"AV"}};
+
+    const auto shape_count = [] {
+        return instrumentation_snapshot().stage(ShapingStage::shape).count;
+    };
+    const auto before = shape_count();
+    const auto spliced = label.instantiate(fields);
+    const auto shapes = shape_count() - before;
+
+    // the field and a few windows per splice point, not one per cluster
+    EXPECT_LE(shapes, 12U);
+    EXPECT_EQ(get_glyphs(spliced.glyph_run()),
+              get_glyphs(HbShapedText {text, get_font()}.glyph_run()));
+}
+
+TEST(ShapedTextTemplate, CountsFields) {
+    const auto label = ShapedTextTemplate {"{1} of {0} {{done}}", get_font()};
+    EXPECT_EQ(label.field_count(), 2U);
+
+    const auto fields = std::array {std::string_view {"3"}, std::string_view {"1"}};
+    const auto whole = HbShapedText {"1 of 3 {done}", get_font()};
+    EXPECT_EQ(get_glyphs(label.instantiate(fields).glyph_run()),
+              get_glyphs(whole.glyph_run()));
+}
+
+TEST(ShapedTextTemplate, ThrowsOnUnmatchedBraces) {
+    EXPECT_THROW(ShapedTextTemplate("{0", get_font()), std::runtime_error);
+    EXPECT_THROW(ShapedTextTemplate("0}", get_font()), std::runtime_error);
+    EXPECT_THROW(ShapedTextTemplate("{x}", get_font()), std::runtime_error);
+}
+
+}  // namespace blend2d_shaping
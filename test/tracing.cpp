@@ -0,0 +1,89 @@
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <latch>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "blend2d_shaping.h"
+
+namespace blend2d_shaping {
+
+namespace {
+
+class RecordingSink final : public TraceSink {
+   public:
+    auto write(std::span<const TraceEvent> events) -> void override {
+        const auto lock = std::scoped_lock {mutex_};
+        events_.insert(events_.end(), events.begin(), events.end());
+    }
+
+    [[nodiscard]] auto size() -> std::size_t {
+        const auto lock = std::scoped_lock {mutex_};
+        return events_.size();
+    }
+
+   private:
+    std::mutex mutex_ {};
+    std::vector<TraceEvent> events_ {};
+};
+
+[[nodiscard]] auto read_file(const std::string &filename) -> std::string {
+    auto file = std::ifstream {filename};
+    return std::string {std::istreambuf_iterator<char> {file}, {}};
+}
+
+}  // namespace
+
+TEST(Tracing, ChromeTraceWriterEscapesStrings) {
+    const auto filename = std::string {"blend2d_shaping_trace_test.json"};
+    {
+        auto writer = ChromeTraceWriter {filename};
+        const auto event = TraceEvent {.name = "say \"hi\"\n", .category = "a\\b"};
+        writer.write(std::span {&event, 1});
+    }
+
+    const auto json = read_file(filename);
+    std::remove(filename.c_str());
+
+    EXPECT_NE(json.find(R"("name":"say \"hi\"\u000a")"), std::string::npos);
+    EXPECT_NE(json.find(R"("cat":"a\\b")"), std::string::npos);
+}
+
+TEST(Tracing, EventsOfReplacedSinkAreDiscarded) {
+    const auto first = std::make_shared<RecordingSink>();
+    const auto second = std::make_shared<RecordingSink>();
+    set_trace_sink(first);
+
+    auto recorded = std::latch {1};
+    auto replaced = std::latch {1};
+    auto thread = std::jthread {[&] {
+        { const auto span = TraceSpan {"stale"}; }
+        recorded.count_down();
+        replaced.wait();
+
+        flush_trace_events();
+        { const auto span = TraceSpan {"current"}; }
+        flush_trace_events();
+    }};
+
+    recorded.wait();
+    set_trace_sink(second);
+    replaced.count_down();
+    thread.join();
+    set_trace_sink(nullptr);
+
+    if (second->size() == 0) {
+        GTEST_SKIP() << "built without BLEND2D_SHAPING_TRACING";
+    }
+    EXPECT_EQ(first->size(), 0U);
+    EXPECT_EQ(second->size(), 1U);
+}
+
+}  // namespace blend2d_shaping
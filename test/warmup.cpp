@@ -0,0 +1,121 @@
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <latch>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "blend2d_shaping.h"
+#include "test_common.h"
+
+namespace blend2d_shaping {
+
+using test_common::get_font;
+using test_common::get_glyphs;
+
+TEST(WarmupProfile, RecordsUsesPerText) {
+    auto profile = WarmupProfile {};
+    profile.record("Hello", get_font());
+    profile.record("Hello", get_font());
+    profile.record("World", get_font(), {}, 1);
+
+    const auto entries = profile.entries();
+    ASSERT_EQ(entries.size(), 2U);
+    EXPECT_EQ(entries[0].text_utf8, "Hello");
+    EXPECT_EQ(entries[0].count, 2U);
+    EXPECT_EQ(entries[0].face_hash, content_hash(test_common::get_font_face().hb_face));
+    EXPECT_EQ(entries[1].text_utf8, "World");
+    EXPECT_EQ(entries[1].priority, 1U);
+
+    profile.clear();
+    EXPECT_EQ(profile.size(), 0U);
+}
+
+TEST(WarmupProfile, PriorityOrdersBeforeCount) {
+    auto profile = WarmupProfile {};
+    profile.record("often", get_font(), {}, 1);
+    profile.record("often", get_font(), {}, 1);
+    profile.record("visible", get_font(), {}, 0);
+
+    const auto entries = profile.entries(1);
+    ASSERT_EQ(entries.size(), 1U);
+    EXPECT_EQ(entries[0].text_utf8, "visible");
+}
+
+TEST(WarmupProfile, SaveAndLoadRoundTrip) {
+    const auto filename = std::string {"blend2d_shaping_warmup_test.bin"};
+    const auto options = ShapingOptions {
+        .backend_policy = ShapingBackendPolicy::harfbuzz,
+        .features = {FontFeature {.tag = BL_MAKE_TAG('t', 'n', 'u', 'm')}},
+    };
+
+    auto profile = WarmupProfile {};
+    profile.record("12:30", get_font(), options, 2);
+    profile.record("Hello", get_font());
+    profile.save(filename.c_str());
+
+    auto loaded = WarmupProfile {};
+    ASSERT_TRUE(loaded.load(filename.c_str()));
+    std::remove(filename.c_str());
+
+    const auto expected = profile.entries();
+    const auto actual = loaded.entries();
+    ASSERT_EQ(actual.size(), expected.size());
+    for (std::size_t i = 0; i < actual.size(); ++i) {
+        EXPECT_EQ(actual[i].text_utf8, expected[i].text_utf8);
+        EXPECT_EQ(actual[i].face_hash, expected[i].face_hash);
+        EXPECT_EQ(actual[i].font_size, expected[i].font_size);
+        EXPECT_EQ(actual[i].options, expected[i].options);
+        EXPECT_EQ(actual[i].priority, expected[i].priority);
+        EXPECT_EQ(actual[i].count, expected[i].count);
+    }
+}
+
+TEST(Warmup, ReplaysEntriesWithMatchingFonts) {
+    auto profile = WarmupProfile {};
+    profile.record("Hello", get_font());
+    profile.record("World", get_font(), {}, 1);
+    // no font of this size is passed to the warmup
+    profile.record("Skipped", create_font(test_common::get_font_face(), 99.0f));
+
+    auto shaped = std::vector<std::pair<std::string, HbShapedText>> {};
+    const auto on_shaped = [&](const WarmupEntry &entry, HbShapedText &&text) {
+        shaped.emplace_back(entry.text_utf8, std::move(text));
+    };
+    start_warmup(profile.entries(), {get_font()}, on_shaped).join();
+
+    ASSERT_EQ(shaped.size(), 2U);
+    EXPECT_EQ(shaped[0].first, "Hello");
+    EXPECT_EQ(shaped[1].first, "World");
+    EXPECT_EQ(get_glyphs(shaped[0].second.glyph_run()),
+              get_glyphs(HbShapedText {"Hello", get_font()}.glyph_run()));
+}
+
+TEST(Warmup, StopsWhenRequested) {
+    auto profile = WarmupProfile {};
+    for (int i = 0; i < 100; ++i) {
+        profile.record(std::to_string(i), get_font());
+    }
+
+    auto count = 0;
+    auto first_shaped = std::latch {1};
+    auto stopped = std::latch {1};
+    const auto on_shaped = [&](const WarmupEntry &, HbShapedText &&) {
+        if (++count == 1) {
+            first_shaped.count_down();
+            stopped.wait();
+        }
+    };
+
+    auto thread = start_warmup(profile.entries(), {get_font()}, on_shaped);
+    first_shaped.wait();
+    thread.request_stop();
+    stopped.count_down();
+    thread.join();
+
+    EXPECT_EQ(count, 1);
+}
+
+}  // namespace blend2d_shaping